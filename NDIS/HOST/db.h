@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 1993,1994
+ *      Texas A&M University.  All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. All advertising materials mentioning features or use of this software
+ *    must display the following acknowledgement:
+ *      This product includes software developed by Texas A&M University
+ *      and its contributors.
+ * 4. Neither the name of the University nor the names of its contributors
+ *    may be used to endorse or promote products derived from this software
+ *    without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE UNIVERSITY AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE UNIVERSITY OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * Developers:
+ *             David K. Hess, Douglas Lee Schales, David R. Safford
+ */
+
+// Host (Unix) replacement for db.h. This lets FILTER.C and BRIDGE.C be
+//   compiled unchanged for the replay tool. The Borland run time pieces they
+//   use are mapped onto the C library here and the NDIS, XMS and misc.asm
+//   layers are stubbed out in STUBS.C.
+#ifndef __HOST_DB_H
+#define __HOST_DB_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+typedef uint8_t  BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef uint16_t UINT;
+
+// Borland keywords and run time.
+#define far
+#define near
+#define huge
+#define __pascal
+
+#ifndef O_BINARY
+#define O_BINARY 0
+#endif
+
+// Real mode pointers are emulated with a flat segment * 16 + offset mapping.
+//   Linear addresses below 0x500 go to a fake BIOS data area so the timer tick
+//   count at 0040:006C can be driven from the capture timestamps.
+#define HOST_BIOS_DATA_SIZE 0x500
+
+extern BYTE hostBiosData[HOST_BIOS_DATA_SIZE];
+
+#define HOST_BIOS_TICKS (*(DWORD *) (hostBiosData + 0x46C))
+
+void *hostMkFp(DWORD,DWORD);
+
+#define MK_FP(seg,off) hostMkFp((DWORD) (seg),(DWORD) (off))
+#define FP_SEG(p)      ((DWORD) (uintptr_t) (p) >> 4)
+#define FP_OFF(p)      ((DWORD) (uintptr_t) (p) & 0x0F)
+
+void *farmalloc(DWORD);
+void farfree(void *);
+
+struct ffblk {
+	char ff_name[256];
+	char ff_pattern[16];
+	DIR *ff_dir;
+};
+
+int findfirst(const char *,struct ffblk *,int);
+int findnext(struct ffblk *);
+
+// Just enough of the NDIS structures for the filter to compile.
+typedef struct _CommonCharacteristics {
+	WORD moduleId;
+	WORD moduleDS;
+	void *serviceCharacteristics;
+	void *serviceStatus;
+	void *upperDispatchTable;
+} CommonCharacteristics;
+
+typedef struct _RxBufDescr {
+	WORD rxDataCount;
+} RxBufDescr;
+
+typedef struct _MacUpperDispatch {
+	WORD (*request)(WORD,WORD,WORD,DWORD,WORD,WORD);
+} MacUpperDispatch;
+
+typedef struct _MacStatusTable {
+	DWORD totalFramesRx;
+	DWORD totalBytesRx;
+	DWORD totalMulticastRx;
+	DWORD totalBroadcastRx;
+	DWORD totalFramesCrc;
+	DWORD totalFramesDiscardedBufferSpaceRx;
+	DWORD totalFramesDiscardedHardwareErrorRx;
+	DWORD totalFramesTx;
+	DWORD totalBytesTx;
+	DWORD totalMulticastTx;
+	DWORD totalBroadcastTx;
+	DWORD totalFramesDiscardedTimeoutTx;
+	DWORD totalFramesDiscardedHardwareErrorTx;
+} MacStatusTable;
+
+#define NDIS_GENERAL_REQUEST_UPDATE_STATISTICS  10
+#define NDIS_GENERAL_REQUEST_CLEAR_STATISTICS   11
+
+// STRUCT.H names these in prototypes before defining them.
+struct _Socket;
+struct _ScheduledEvent;
+
+#include "CONST.H"
+#include "XMS.H"
+#include "STRUCT.H"
+#include "PROTO.H"
+#include "GLOBAL.H"
+#include "MACRO.H"
+
+// There are no interrupt threads on the host.
+#undef GUARD
+#undef UNGUARD
+#define GUARD
+#define UNGUARD
+
+// From stubs.c
+extern DWORD hostSyslogEvents[SYSL_OUT_OFFSET + 1];
+extern DWORD hostLastEvent;
+
+void initHost(void);
+
+#endif
@@ -144,12 +144,11 @@ static __inline int __get_order (DWORD size)
 static void *dma_mem_alloc (int size, WORD *dma_sel)
 {
   DWORD phys;
-  int   sel;
 
-  if (_dma_allocate(size,&sel,&phys) < 0)
+  if (size > DMA_BOUNCE_SIZE || (phys = dma_bounce_get()) == 0)
      return (NULL);
 
-  *dma_sel = (WORD)sel;
+  *dma_sel = _dos_ds;
   return (void*)phys;
 }
 
@@ -628,9 +627,9 @@ static void elp_interrupt (int irq)
       else if (adapter->current_dma.data_len)
       {
         if (adapter->current_dma.target)
-           memcpy (adapter->current_dma.target,
-                   adapter->dma_buffer,
-                   adapter->current_dma.length);
+           memcpy_fromio (adapter->current_dma.target,
+                          adapter->dma_buffer,
+                          adapter->current_dma.length);
 
         if (dev->get_rx_buf)
         {
@@ -1130,7 +1129,7 @@ static void elp_close (struct device *dev)
   irq2dev_map[dev->irq] = NULL;
 
   _dma_stop (dev->dma);
-  __dpmi_free_dos_memory (adapter->dma_selector);
+  dma_bounce_put ((DWORD)adapter->dma_buffer);
 }
 
 
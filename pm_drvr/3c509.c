@@ -34,6 +34,8 @@ static char *version = "3c509.c:1.07 6/15/95 becker@cesdis.gsfc.nasa.gov";
 
 #include "pmdrvr.h"
 #include "module.h"
+#include "trace.h"
+#include "rxearly.h"
 
 #undef  STATIC
 #define STATIC /* for.map-file */
@@ -117,6 +119,14 @@ enum RxFilter {
 #define WN4_MEDIA  0x0A           /* Window 4: Various transcvr/media bits. */
 #define   MEDIA_TP 0x00C0         /* Enable link beat and jabber for 10baseT. */
 
+/*
+ * Our dev->priv; el3_get_stats() returns it as the stats.
+ */
+struct el3_private {
+       struct net_device_stats stats;   /* must be first */
+       struct rx_early         early;
+     };
+
 
 int el3_debug    LOCKED_VAR = 0;  /* debug level */
 int el3_max_loop LOCKED_VAR = 10; /* max # of loops allowed in el3_interrupt() */
@@ -133,6 +143,7 @@ static void *el3_get_stats     (struct device *dev);
 static void  set_multicast_list(struct device *dev);
 
 STATIC void  el3_receive   (struct device *dev)            LOCKED_FUNC;
+STATIC void  el3_rx_early  (struct device *dev)            LOCKED_FUNC;
 STATIC void  el3_interrupt (int irq)                       LOCKED_FUNC;
 STATIC void  el3_update    (int, struct device*, unsigned) LOCKED_FUNC;
 
@@ -301,7 +312,7 @@ found:
 
   /* Make up a EL3-specific-data structure
    */
-  dev->priv = k_calloc (sizeof(struct net_device_stats), 1);
+  dev->priv = k_calloc (sizeof(struct el3_private), 1);
   if (!dev->priv)
      return (0);
 
@@ -361,6 +372,7 @@ static WORD read_eeprom_id (int index)
 
 static int el3_open (struct device *dev)
 {
+  struct el3_private *lp = (struct el3_private*) dev->priv;
   int i, ioaddr = dev->base_addr;
 
   outw (TxReset, ioaddr + EL3_CMD);
@@ -431,6 +443,11 @@ static int el3_open (struct device *dev)
   outw (SetRxFilter | RxStation | RxBroadcast, ioaddr + EL3_CMD);
   outw (StatsEnable, ioaddr + EL3_CMD);    /* Turn on statistics */
 
+  /* Raise RxEarly when 'thresh' bytes of a frame are in the FIFO
+   */
+  if (rx_early_init (&lp->early))
+     outw (SetRxThreshold | lp->early.thresh, ioaddr + EL3_CMD);
+
   dev->reentry = 0;
   dev->tx_busy = 0;
   dev->start   = 1;
@@ -446,8 +463,8 @@ static int el3_open (struct device *dev)
    */
   outw (AckIntr | IntLatch | TxAvailable | RxEarly | IntReq,
         ioaddr + EL3_CMD);
-  outw (SetIntrEnb | IntLatch | TxAvailable | TxComplete | RxComplete | StatsFull,
-        ioaddr + EL3_CMD);
+  outw (SetIntrEnb | IntLatch | TxAvailable | TxComplete | RxComplete | StatsFull |
+        (lp->early.thresh ? RxEarly : 0), ioaddr + EL3_CMD);
 
   if (el3_debug > 3)
      printk ("%s: Opened 3c509, IRQ %d, status %04X.\n",
@@ -584,6 +601,7 @@ STATIC void el3_interrupt (int irq)
 
   ioaddr = dev->base_addr;
   status = inw (ioaddr + EL3_STATUS);
+  TRACE2 (TRC_DRVR, "%s: interrupt, status %04X\n", dev->name, status);
 
   if (el3_debug > 5)
   {
@@ -624,9 +642,9 @@ STATIC void el3_interrupt (int irq)
       if (status & StatsFull)   /* Empty statistics */
          el3_update (ioaddr, dev, __LINE__);
 
-      if (status & RxEarly)     /* Rx early is unused */
+      if (status & RxEarly)     /* Read a frame still arriving */
       {   
-        el3_receive (dev);
+        el3_rx_early (dev);
         outw (AckIntr | RxEarly, ioaddr + EL3_CMD);
       }
       if (status & TxComplete)  /* Really Tx error. */
@@ -651,9 +669,14 @@ STATIC void el3_interrupt (int irq)
       }
       if (status & AdapterFailure)
       {
+        struct el3_private *lp = (struct el3_private*) dev->priv;
+
         /* Adapter failure requires Rx reset and reinit
          */
         outw (RxReset, ioaddr + EL3_CMD);
+        rx_early_reset (&lp->early);
+        if (lp->early.thresh)
+           outw (SetRxThreshold | lp->early.thresh, ioaddr + EL3_CMD);
 
         /* Set the Rx filter to the current state
          */
@@ -743,6 +766,7 @@ STATIC void el3_update (int ioaddr, DEVICE *dev, unsigned line)
 STATIC void el3_receive (struct device *dev)
 {
   struct net_device_stats *stats = (struct net_device_stats*) dev->priv;
+  struct el3_private      *lp    = (struct el3_private*) dev->priv;
   int    ioaddr = dev->base_addr;
   short  rx_status;
 
@@ -757,6 +781,7 @@ STATIC void el3_receive (struct device *dev)
       short error = (rx_status & 0x3800);
 
       outw (RxDiscard, ioaddr + EL3_CMD);
+      rx_early_reset (&lp->early);
       stats->rx_errors++;
       switch (error)
       {
@@ -789,17 +814,49 @@ STATIC void el3_receive (struct device *dev)
       }
 #endif
     }
+    else if (lp->early.thresh)
+    {
+      /* The head may have been read on RxEarly already
+       */
+      int rest = (rx_status & 0x7ff);
+      int len  = lp->early.len + rest;
+
+      TRACE2 (TRC_RX, "%s: Rx packet size %d\n", dev->name, len);
+
+      stats->rx_packets++;
+      stats->rx_bytes += len;
+      if (rx_early_finish (&lp->early, dev, ioaddr + RX_FIFO, rest, stats) &&
+          el3_debug > 4)
+         printk ("  Rx packet size %d (%d early).\n", len, len - rest);
+
+      outw (RxDiscard, ioaddr + EL3_CMD);
+    }
     else
     {
-      int  len = (rx_status & 0x7ff);
+      int   len  = (rx_status & 0x7ff);
+      int   peek = rx_peek_size (dev, len);
+      DWORD hdr [RX_PEEK_MAX/4];
       char *buf;
 
+      TRACE2 (TRC_RX, "%s: Rx packet size %d\n", dev->name, len);
+
       stats->rx_packets++;
       stats->rx_bytes += len;
 
-      if (dev->get_rx_buf && (buf = (*dev->get_rx_buf) (len)) != NULL)
+      /* Read the header only; RxDiscard below drops the rest of a
+       * rejected frame in the FIFO.
+       */
+      if (peek)
+         rep_insl (ioaddr + RX_FIFO, hdr, peek >> 2);
+
+      if (peek && !(*dev->rx_prefilter) ((const BYTE*)hdr, peek, len))
+         stats->rx_prefiltered++;
+
+      else if (dev->get_rx_buf && (buf = (*dev->get_rx_buf) (len)) != NULL)
       {
-        rep_insl (ioaddr + RX_FIFO, (DWORD*)buf, (len + 3) >> 2);
+        if (peek)
+           memcpy (buf, hdr, peek);
+        rep_insl (ioaddr + RX_FIFO, (DWORD*)(buf + peek), (len - peek + 3) >> 2);
         if (el3_debug > 4)
            printk ("  Rx packet size %d.\n", len);
       }
@@ -824,6 +881,20 @@ STATIC void el3_receive (struct device *dev)
   }
 }
 
+/*
+ * RxEarly: read what has arrived of the top frame if it is still
+ * incomplete. el3_receive() reads the rest on RxComplete.
+ */
+STATIC void el3_rx_early (struct device *dev)
+{
+  struct el3_private *lp = (struct el3_private*) dev->priv;
+  int    ioaddr    = dev->base_addr;
+  int    rx_status = inw (ioaddr + RX_STATUS);
+
+  if (lp->early.thresh && (rx_status & 0xC000) == 0x8000)
+     rx_early_read (&lp->early, ioaddr + RX_FIFO, rx_status & 0x7ff);
+}
+
 /*
  *  Set or clear the multicast filter for this adaptor.
  */
@@ -856,6 +927,7 @@ static void set_multicast_list (struct device *dev)
 
 static void el3_close (struct device *dev)
 {
+  struct el3_private *lp = (struct el3_private*) dev->priv;
   int ioaddr = dev->base_addr;
 
   if (el3_debug > 2)
@@ -904,6 +976,11 @@ static void el3_close (struct device *dev)
 
   free_irq (dev->irq);
   irq2dev_map[dev->irq] = NULL;
+
+  if (el3_debug > 1 && lp->early.frames)
+     printk ("%s: %lu frames read early, %lu RxEarly reads.\n",
+             dev->name, lp->early.frames, lp->early.reads);
+  rx_early_free (&lp->early);
 }
 
 
@@ -931,11 +1008,13 @@ struct libc_import imports;
 
 struct device *wlm_main (struct libc_import *li, int debug_level)
 {
+#ifndef USE_DXE3
   unsigned *src = (unsigned*) li;
   unsigned *dst = (unsigned*) &imports;
 
   while (*src)
     *dst++ = *src++;
+#endif
 
   if (debug_level > 0)
      el3_debug = debug_level;
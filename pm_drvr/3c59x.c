@@ -24,6 +24,7 @@ static char *version = "3c59x.c:v0.25 5/17/96 becker@cesdis.gsfc.nasa.gov\n";
 #include "bios32.h"
 #include "pci.h"
 #include "3c59x.h"
+#include "rxearly.h"
 
 int vortex_debug LOCKED_VAR = VORTEX_DEBUG;
 
@@ -42,6 +43,7 @@ struct vortex_private {
        struct device *next_module;
        struct net_device_stats stats;
        struct timer_list timer;   /* Media selection timer */
+       struct rx_early   early;   /* Frame read while arriving */
        int    options;            /* User-settable misc. driver options */
        int    last_rx_packets;    /* For media autoselection */
        DWORD  available_media:8,  /* From Wn3_Options */
@@ -83,6 +85,7 @@ static void *vortex_get_stats  (struct device *dev);
 static void  vortex_close      (struct device *dev);
 
 STATIC void  vortex_recv       (struct device *dev)           LOCKED_FUNC;
+STATIC void  vortex_rx_early   (struct device *dev)           LOCKED_FUNC;
 STATIC void  vortex_interrupt  (int irq)                      LOCKED_FUNC;
 STATIC void  vortex_update     (int addr, struct device *dev) LOCKED_FUNC;
 STATIC void  vortex_set_mode   (struct device *dev)           LOCKED_FUNC;
@@ -450,6 +453,12 @@ static int vortex_open (struct device *dev)
   vortex_set_mode (dev);
   outw (StatsEnable, ioaddr + EL3_CMD); /* Turn on statistics. */
 
+  /* Raise RxEarly when 'thresh' bytes of a frame are in the FIFO.
+   * The Vortex counts the threshold in dwords.
+   */
+  if (rx_early_init (&vp->early))
+     outw (SetRxThreshold | (vp->early.thresh >> 2), ioaddr + EL3_CMD);
+
   dev->tx_busy = 0;
   dev->reentry = 0;
   dev->start   = 1;
@@ -465,8 +474,8 @@ static int vortex_open (struct device *dev)
    */
   outw (AckIntr | IntLatch | TxAvailable | RxEarly | IntReq,
         ioaddr + EL3_CMD);
-  outw (SetIntrEnb | IntLatch | TxAvailable | RxComplete | StatsFull | DMADone,
-        ioaddr + EL3_CMD);
+  outw (SetIntrEnb | IntLatch | TxAvailable | RxComplete | StatsFull | DMADone |
+        (vp->early.thresh ? RxEarly : 0), ioaddr + EL3_CMD);
 
   return (1);
 }
@@ -780,9 +789,9 @@ STATIC void vortex_interrupt (int irq)
     {
       /* Handle all uncommon interrupts at once
        */
-      if (status & RxEarly)        /* Rx early is unused */
+      if (status & RxEarly)        /* Read a frame still arriving */
       {
-        vortex_recv (dev);
+        vortex_rx_early (dev);
         outw (AckIntr | RxEarly, ioaddr + EL3_CMD);
       }
       if (status & StatsFull)      /* Empty statistics */
@@ -817,9 +826,15 @@ STATIC void vortex_interrupt (int irq)
       }
       if (status & AdapterFailure)
       {
+        struct vortex_private *vp = (struct vortex_private*) dev->priv;
+
         /* Adapter failure requires Rx reset and reinit
          */
         outw (RxReset, ioaddr + EL3_CMD);
+        rx_early_reset (&vp->early);
+        if (vp->early.thresh)
+           outw (SetRxThreshold | (vp->early.thresh >> 2), ioaddr + EL3_CMD);
+
         /* Set the Rx filter to the current state
          */
         vortex_set_mode (dev);
@@ -878,22 +893,57 @@ STATIC void vortex_recv (struct device *dev)
       if (rx_error & 0x04)  vp->stats.rx_frame_errors++;
       if (rx_error & 0x08)  vp->stats.rx_crc_errors++;
       if (rx_error & 0x10)  vp->stats.rx_length_errors++;
+      rx_early_reset (&vp->early);
+    }
+    else if (vp->early.thresh)
+    {
+      /* The head may have been read on RxEarly already
+       */
+      int rest = rx_status & 0x1fff;
+
+      if (vortex_debug > 4)
+         printk ("Receiving packet size %d (%d early) status %4x.\n",
+                 vp->early.len + rest, vp->early.len, rx_status);
+
+      rx_early_finish (&vp->early, dev, ioaddr + RX_FIFO, rest, &vp->stats);
+      outw (RxDiscard, ioaddr + EL3_CMD); /* Pop top Rx packet. */
+
+      for (i = 200; i >= 0; i--)
+         if (!inw(ioaddr + EL3_STATUS) & CmdInProgress)
+            break;
+      vp->stats.rx_packets++;
+      continue;
     }
     else
     {
       /* The packet length: up to 4.5K!.
        */
       short pkt_len = rx_status & 0x1fff;
+      int   peek    = rx_peek_size (dev, pkt_len);
+      DWORD hdr [RX_PEEK_MAX/4];
 
       if (vortex_debug > 4)
          printk ("Receiving packet size %d status %4x.\n",
                  pkt_len, rx_status);
 
-      if (dev->get_rx_buf)
+      /* Read the header only; RxDiscard drops the rest of a rejected
+       * frame in the FIFO.
+       */
+      if (peek)
+         rep_insl (ioaddr + RX_FIFO, hdr, peek >> 2);
+
+      if (peek && !(*dev->rx_prefilter) ((const BYTE*)hdr, peek, pkt_len))
+         vp->stats.rx_prefiltered++;
+
+      else if (dev->get_rx_buf)
       {
         char *buf = (*dev->get_rx_buf) (pkt_len);
         if (buf)
-             rep_insl (ioaddr + RX_FIFO, (DWORD*)buf, (pkt_len+3) >> 2);
+        {
+          if (peek)
+             memcpy (buf, hdr, peek);
+          rep_insl (ioaddr + RX_FIFO, (DWORD*)(buf + peek), (pkt_len - peek + 3) >> 2);
+        }
         else vp->stats.rx_dropped++;
       }
       outw (RxDiscard, ioaddr + EL3_CMD); /* Pop top Rx packet. */
@@ -917,6 +967,20 @@ STATIC void vortex_recv (struct device *dev)
   }
 }
 
+/*
+ * RxEarly: read what has arrived of the top frame if it is still
+ * incomplete. vortex_recv() reads the rest on RxComplete.
+ */
+STATIC void vortex_rx_early (struct device *dev)
+{
+  struct vortex_private *vp = (struct vortex_private*) dev->priv;
+  int    ioaddr    = dev->base_addr;
+  int    rx_status = inw (ioaddr + RxStatus);
+
+  if (vp->early.thresh && (rx_status & 0xC000) == 0x8000)
+     rx_early_read (&vp->early, ioaddr + RX_FIFO, rx_status & 0x1fff);
+}
+
 static void vortex_close (struct device *dev)
 {
   struct vortex_private *vp = (struct vortex_private*) dev->priv;
@@ -950,6 +1014,11 @@ static void vortex_close (struct device *dev)
 
   free_irq (dev->irq);
   irq2dev_map[dev->irq] = NULL;
+
+  if (vortex_debug > 1 && vp->early.frames)
+     printk ("%s: %lu frames read early, %lu RxEarly reads.\n",
+             dev->name, vp->early.frames, vp->early.reads);
+  rx_early_free (&vp->early);
 }
 
 static void *vortex_get_stats (struct device *dev)
@@ -64,6 +64,9 @@
 
 #include "pmdrvr.h"
 #include "module.h"
+#include "rxring.h"
+#include "trace.h"
+#include "txsg.h"
 #include "bios32.h"
 #include "pci.h"
 
@@ -141,7 +144,7 @@ STATIC void  IndicateToOSLinkStateChange (struct NIC_INFORMATION *Adapter);
 STATIC void  SetupNewSpeed (struct NIC_INFORMATION *Adapter);
 STATIC DWORD SetupNewDuplex (struct NIC_INFORMATION *Adapter);
 STATIC void  TxCompleteEvent (struct NIC_INFORMATION *Adapter);
-STATIC void  UpCompleteEvent (struct NIC_INFORMATION *Adapter);
+STATIC int   UpCompleteEvent (struct NIC_INFORMATION *Adapter, int Budget);
 STATIC void  HostErrorEvent (struct NIC_INFORMATION *Adapter);
 STATIC void  UpdateStatisticsEvent (struct NIC_INFORMATION *Adapter);
 STATIC void  CountDownTimerEvent (struct NIC_INFORMATION *Adapter);
@@ -149,10 +152,19 @@ STATIC void  CountDownTimerEvent (struct NIC_INFORMATION *Adapter);
 STATIC int   NICOpen (struct device *Device);
 STATIC void  NICClose (struct device *Device);
 STATIC int   NICSendPacket (struct device *Device, const void *buf, int len);
+STATIC int   NICSendFrags (struct device *Device, const struct tx_frag *Frag,
+                           int NumFrags, tx_done_fn Done, void *Arg);
+STATIC int   QueueDPD (struct device *Device, const struct tx_frag *Frag,
+                       int NumFrags, int Copy,
+                       tx_done_fn Done, void *Arg);
+STATIC void  CompleteDPD (struct DPD_LIST_ENTRY *Dpd, int Ok);
 STATIC void *NICGetStatistics (struct device *Device);
 STATIC void  NICSetReceiveMode (struct device *Device);
 STATIC void  NICTimer (DWORD Data);
-STATIC void  NICInterrupt (int Irq);
+STATIC int   NICInterrupt (int Irq, struct device *Device);
+STATIC int   NICPoll (struct device *Device, int Budget);
+STATIC int   NICSetCoalesce (struct device *Device, int Frames, int Usecs);
+STATIC int   UpdsComplete (struct NIC_INFORMATION *Adapter, int Max);
          
 
 /*
@@ -380,9 +392,14 @@ STATIC void FillDeviceStructure (struct NIC_INFORMATION *adapter)
    */
   device->open      = NICOpen;
   device->xmit      = NICSendPacket;
+  device->xmit_sg   = NICSendFrags;
+  device->tx_max_frags = MAXIMUM_SCATTER_GATHER_LIST;
   device->close     = NICClose;
   device->get_stats = NICGetStatistics;
   device->set_multicast_list = NICSetReceiveMode;
+  device->poll      = NICPoll;
+  device->set_coalesce  = NICSetCoalesce;
+  device->coal_adaptive = 1;
 }
 
 
@@ -496,6 +513,8 @@ STATIC void NICClose (struct device *Device)
 
   Device->start = 0;
   Device->tx_busy = 1;
+  netif_rx_complete (Device);
+  adapter->RxDeferred = FALSE;
 
   /* Disable transmit and receive.
    */
@@ -547,8 +566,7 @@ STATIC void NICClose (struct device *Device)
   if (adapter->ResourcesReserved & NIC_INTERRUPT_REGISTERED)
   {
     DBGPRINT_INITIALIZE (("Releasing interrupt\n"));
-    free_irq (device->irq);
-    irq2dev_map[device->irq] = NULL;
+    free_shared_irq (device->irq, device);
     adapter->ResourcesReserved &= ~NIC_INTERRUPT_REGISTERED;
   }
 
@@ -1295,16 +1313,14 @@ STATIC BOOL GetLinkSpeed (struct NIC_INFORMATION *adapter,
  */
 STATIC void FreeAdapterResources (struct NIC_INFORMATION *adapter)
 {
-  struct device         *device            = adapter->Device;
-  struct UPD_LIST_ENTRY *currentUPDVirtual = adapter->HeadUPDVirtual;
+  struct device *device = adapter->Device;
 
   DBGPRINT_FUNCTION (("FreeAdapterResources: IN\n"));
 
   if (adapter->ResourcesReserved & NIC_INTERRUPT_REGISTERED)
   {
     DBGPRINT_INITIALIZE (("Releasing interrupt\n"));
-    free_irq (device->irq);
-    irq2dev_map[device->irq] = NULL;
+    free_shared_irq (device->irq, device);
     adapter->ResourcesReserved &= ~NIC_INTERRUPT_REGISTERED;
   }
 
@@ -1330,20 +1346,12 @@ STATIC void FreeAdapterResources (struct NIC_INFORMATION *adapter)
   if (adapter->ResourcesReserved & NIC_SHARED_MEMORY_ALLOCATED)
   {
     DBGPRINT_INITIALIZE (("Releasing memory\n"));
-    currentUPDVirtual = adapter->HeadUPDVirtual;
 
-    /* Release the SKBs allocated
+    /* Release the receive buffers
      */
-    while (1)
-    {
-      if (currentUPDVirtual->SocketBuffer)
-         k_free (currentUPDVirtual->SocketBuffer);
-      currentUPDVirtual = currentUPDVirtual->Next;
-      if (currentUPDVirtual == adapter->HeadUPDVirtual)
-         break;
-    }
+    rx_ring_free (&adapter->RxRing);
 
-    k_free (adapter->Resources.SharedMemoryVirtual);
+    k_free_aligned (adapter->Resources.SharedMemoryVirtual);
     adapter->ResourcesReserved &= ~NIC_SHARED_MEMORY_ALLOCATED;
   }
   DBGPRINT_FUNCTION (("FreeAdapterResources: OUT\n"));
@@ -1363,13 +1371,11 @@ STATIC DWORD RegisterAdapter (struct NIC_INFORMATION *adapter)
    */
   DBGPRINT_INITIALIZE (("registering IRQ %d\n", device->irq));
 
-  /* MUST set irq2dev_map first, because IRQ may come
-   * before request_irq() returns.
+  /* Several adapters (or other PCI devices) may share the line.
+   * NICInterrupt() gets the device from the chain, not irq2dev_map.
    */
-  irq2dev_map [device->irq] = device;
-  if (!request_irq (device->irq, NICInterrupt))
+  if (!request_shared_irq (device->irq, NICInterrupt, device, 0))
   {
-    irq2dev_map [device->irq] = NULL;
     DBGPRINT_ERROR (("RegisterAdapter: IRQ registration failed\n"));
     return (NIC_STATUS_FAILURE);
   }
@@ -1768,6 +1774,8 @@ STATIC DWORD AllocateSharedMemory (struct NIC_INFORMATION *adapter)
   DWORD  memoryBaseVirtual, memoryBasePhysical;
   DWORD  updMemoryVirtualStart, updMemoryPhysicalStart;
   DWORD  dpdMemoryVirtualStart, dpdMemoryPhysicalStart;
+  DWORD  txMemoryForOne, totalTxMemory;
+  DWORD  txMemoryVirtualStart, txMemoryPhysicalStart;
   DWORD  currentUPDPhysical, previousUPDPhysical;
   DWORD  firstUPDPhysical = 0;
   DWORD  currentDPDPhysical = 0;
@@ -1792,20 +1800,39 @@ STATIC DWORD AllocateSharedMemory (struct NIC_INFORMATION *adapter)
   dpdMemoryForOne = sizeof (struct DPD_LIST_ENTRY) + cacheLineSize;
   totalDPDMemory = adapter->Resources.SendCount * dpdMemoryForOne;
 
+  /* A transmit buffer per DPD for NICSendPacket() to copy into.
+   */
+  txMemoryForOne = ETHERNET_MAXIMUM_FRAME_SIZE + cacheLineSize;
+  totalTxMemory  = adapter->Resources.SendCount * txMemoryForOne;
+
   /* Calculate the test memory required.
    */
   totalTestMemory = MAXIMUM_TEST_BUFFERS * (dpdMemoryForOne + rxMemoryForOne);
   total = adapter->Resources.SharedMemorySize = totalUPDMemory +
                                                 totalDPDMemory +
+                                                totalTxMemory +
                                                 totalTestMemory;
   /* Allocate the memory
    */
-  adapter->Resources.SharedMemoryVirtual = k_calloc (total, 1);
+  adapter->Resources.SharedMemoryVirtual = k_malloc_aligned (total, cacheLineSize);
   if (!adapter->Resources.SharedMemoryVirtual)
      return (NIC_STATUS_FAILURE);
 
+  memset (adapter->Resources.SharedMemoryVirtual, 0, total);
+
   adapter->ResourcesReserved |= NIC_SHARED_MEMORY_ALLOCATED;
 
+  /* Receive buffers; capture slots the NIC uploads into directly
+   * if the capture layer offers them.
+   */
+  if (rx_ring_init (&adapter->RxRing, adapter->Device,
+                    adapter->Resources.ReceiveCount,
+                    ETHERNET_MAXIMUM_FRAME_SIZE, 0))
+  {
+    DBGPRINT_ERROR (("Receive buffer allocation failed\n"));
+    return (NIC_STATUS_FAILURE);
+  }
+
   /* Carve out the regions
    */
   memoryBaseVirtual  = (DWORD) adapter->Resources.SharedMemoryVirtual;
@@ -1817,13 +1844,15 @@ STATIC DWORD AllocateSharedMemory (struct NIC_INFORMATION *adapter)
    */
   updMemoryVirtualStart  = memoryBaseVirtual;
   dpdMemoryVirtualStart  = updMemoryVirtualStart + totalUPDMemory;
-  testMemoryVirtualStart = dpdMemoryVirtualStart + totalDPDMemory;
+  txMemoryVirtualStart   = dpdMemoryVirtualStart + totalDPDMemory;
+  testMemoryVirtualStart = txMemoryVirtualStart  + totalTxMemory;
 
   /* Physical addresses of the regions.
    */
   updMemoryPhysicalStart  = memoryBasePhysical;
   dpdMemoryPhysicalStart  = updMemoryPhysicalStart + totalUPDMemory;
-  testMemoryPhysicalStart = dpdMemoryPhysicalStart + totalDPDMemory;
+  txMemoryPhysicalStart   = dpdMemoryPhysicalStart + totalDPDMemory;
+  testMemoryPhysicalStart = txMemoryPhysicalStart  + totalTxMemory;
 
   /* Make the receive structures
    */
@@ -1857,17 +1886,11 @@ STATIC DWORD AllocateSharedMemory (struct NIC_INFORMATION *adapter)
       currentUPDVirtual->Previous       = previousUPDVirtual;
     }
 
-    /* Allocate a receive buffer per UPD
+    /* Attach a receive buffer per UPD
      */
-    currentUPDVirtual->SocketBuffer = k_calloc (ETHERNET_MAXIMUM_FRAME_SIZE + 2, 1);
-    if (currentUPDVirtual->SocketBuffer == NULL)
-    {
-      DBGPRINT_ERROR (("Socket buffer allocation failed\n"));
-      return (NIC_STATUS_FAILURE);
-    }
-
-    currentUPDVirtual->RxBufferVirtual   = currentUPDVirtual->SocketBuffer;
-    currentUPDVirtual->SGList[0].Address = VIRT_TO_PHYS (currentUPDVirtual->SocketBuffer);
+    currentUPDVirtual->RxRingIndex       = count;
+    currentUPDVirtual->RxBufferVirtual   = rx_ring_buf (&adapter->RxRing, count);
+    currentUPDVirtual->SGList[0].Address = VIRT_TO_PHYS (currentUPDVirtual->RxBufferVirtual);
     currentUPDVirtual->SGList[0].Count   = ETHERNET_MAXIMUM_FRAME_SIZE | 0x80000000;
 
     previousUPDVirtual  = currentUPDVirtual;
@@ -1900,6 +1923,13 @@ STATIC DWORD AllocateSharedMemory (struct NIC_INFORMATION *adapter)
      */
     currentDPDVirtual->DPDPhysicalAddress = currentDPDPhysical;
 
+    /* Attach a transmit buffer per DPD
+     */
+    alignment = cacheLineSize - ((txMemoryPhysicalStart + count * txMemoryForOne) %
+                                 cacheLineSize);
+    currentDPDVirtual->TxBuffer = (BYTE*) (txMemoryVirtualStart +
+                                  count * txMemoryForOne + alignment);
+
     if (0 == count)
        headDPDVirtual = currentDPDVirtual;
     else
@@ -2295,12 +2325,48 @@ STATIC void ReStartAdapter (struct NIC_INFORMATION *adapter)
 
 
 /*
- * This routine sends the packet 
+ * This routine sends the packet. The caller may reuse 'buf' as soon
+ * as we return, so it is copied to the transmit buffer of its DPD.
  */
 STATIC int NICSendPacket (struct device *Device, const void *buf, int len)
+{
+  struct tx_frag frag;
+
+  if (len > ETHERNET_MAXIMUM_FRAME_SIZE)
+     return (0);
+
+  frag.data = buf;
+  frag.len  = len;
+  return QueueDPD (Device, &frag, 1, TRUE, NULL, NULL);
+}
+
+
+/*
+ * This routine sends a packet from a fragment list without copying.
+ * 'Done' is called when the NIC has read it (see txsg.h).
+ */
+STATIC int NICSendFrags (struct device *Device, const struct tx_frag *Frag,
+                         int NumFrags, tx_done_fn Done, void *Arg)
+{
+  return QueueDPD (Device, Frag, NumFrags, FALSE, Done, Arg);
+}
+
+
+/*
+ * This routine puts a packet on the DPD ring, one SG entry per
+ * fragment. With 'Copy' set the fragments are gathered into the
+ * DPD's transmit buffer instead.
+ */
+STATIC int QueueDPD (struct device *Device, const struct tx_frag *Frag,
+                     int NumFrags, int Copy,
+                     tx_done_fn Done, void *Arg)
 {
   struct NIC_INFORMATION *adapter = (struct NIC_INFORMATION*) Device->priv;
   struct DPD_LIST_ENTRY  *dpdVirtual;
+  int    i, num = 0, len = 0;
+
+  if (NumFrags > MAXIMUM_SCATTER_GATHER_LIST)
+     return (0);
 
   if (Device->tx_busy)
   {
@@ -2319,17 +2385,48 @@ STATIC int NICSendPacket (struct device *Device, const void *buf, int len)
   /* Get the free DPD from the DPD ring
    */
   dpdVirtual = adapter->TailDPDVirtual;
-  dpdVirtual->FrameStartHeader  = 0;
-  dpdVirtual->SGList[0].Address = VIRT_TO_PHYS (buf);
-  dpdVirtual->SGList[0].Count   = len | 0x80000000;
-  dpdVirtual->FrameStartHeader |= (DWORD) FSH_ROUND_UP_DEFEAT;
-  dpdVirtual->SocketBuffer      = (BYTE*) buf;
+  if (Copy)
+  {
+    len = tx_frag_copy (dpdVirtual->TxBuffer, Frag, NumFrags);
+    if (len > 0)
+    {
+      dpdVirtual->SGList[0].Address = VIRT_TO_PHYS (dpdVirtual->TxBuffer);
+      dpdVirtual->SGList[0].Count   = len;
+      num = 1;
+    }
+  }
+  else
+  {
+    for (i = 0; i < NumFrags; i++)
+    {
+      if (Frag[i].len <= 0)
+         continue;
+      dpdVirtual->SGList[num].Address = VIRT_TO_PHYS (Frag[i].data);
+      dpdVirtual->SGList[num].Count   = Frag[i].len;
+      len += Frag[i].len;
+      num++;
+    }
+  }
+  if (num == 0)
+  {
+    Device->tx_busy = 0;
+    return (0);
+  }
+
+  /* Mark the last fragment.
+   */
+  dpdVirtual->SGList[num-1].Count |= 0x80000000;
+  dpdVirtual->FrameStartHeader  = (DWORD) FSH_ROUND_UP_DEFEAT;
+  dpdVirtual->TxDone            = Done;
+  dpdVirtual->TxArg             = Arg;
   dpdVirtual->PacketLength      = len;
   dpdVirtual->DownNextPointer   = 0;
 
   DISABLE();
   NIC_COMMAND_WAIT (adapter, COMMAND_DOWN_STALL);
   adapter->BytesInDPDQueue += len;
+  adapter->TxRingUsed++;
+  RING_HIWATER (adapter->TxRingHiwater, adapter->TxRingUsed);
   adapter->TailDPDVirtual->Previous->DownNextPointer = dpdVirtual->DPDPhysicalAddress;
   adapter->TailDPDVirtual = dpdVirtual->Next;
   NIC_COMMAND (adapter, COMMAND_DOWN_UNSTALL);
@@ -2342,6 +2439,21 @@ STATIC int NICSendPacket (struct device *Device, const void *buf, int len)
 }
 
 
+/*
+ * This routine tells the owner of the fragments of a DPD that the
+ * NIC is done with them. Called from the interrupt handler; nothing
+ * is freed here.
+ */
+STATIC void CompleteDPD (struct DPD_LIST_ENTRY *Dpd, int Ok)
+{
+  tx_done_fn done = Dpd->TxDone;
+
+  Dpd->TxDone = NULL;
+  if (done)
+    (*done) (Dpd->TxArg, Ok);
+}
+
+
 /*
  * This routine handles the Tx complete event.
  */
@@ -2502,9 +2614,7 @@ STATIC void CleanupSendLogic (struct device *Device)
      */
     adapter->BytesInDPDQueue -= headDPDVirtual->PacketLength;
 
-    k_free (headDPDVirtual->SocketBuffer);
-
-    headDPDVirtual->SocketBuffer = NULL;
+    CompleteDPD (headDPDVirtual, FALSE);
     headDPDVirtual->FrameStartHeader = 0;
 
     headDPDVirtual = headDPDVirtual->Next;
@@ -2513,6 +2623,7 @@ STATIC void CleanupSendLogic (struct device *Device)
   /* Update the head to point to this DPD now.
    */
   adapter->HeadDPDVirtual = headDPDVirtual;
+  adapter->TxRingUsed = 0;
 
   /* Initialize all DPDs.
    */
@@ -2521,7 +2632,7 @@ STATIC void CleanupSendLogic (struct device *Device)
   while (1)
   {
     headDPDVirtual->DownNextPointer = 0;
-    headDPDVirtual->SocketBuffer = NULL;
+    headDPDVirtual->TxDone = NULL;
     headDPDVirtual->FrameStartHeader = 0;
     headDPDVirtual = headDPDVirtual->Next;
     if (headDPDVirtual == adapter->HeadDPDVirtual)
@@ -2532,19 +2643,25 @@ STATIC void CleanupSendLogic (struct device *Device)
 
 
 /*
- * This routine handles the receive event.
+ * This routine handles the receive event. At most 'budget' UPDs are
+ * processed; returns the number processed.
  */
-STATIC void UpCompleteEvent (struct NIC_INFORMATION *adapter)
+STATIC int UpCompleteEvent (struct NIC_INFORMATION *adapter, int budget)
 {
   struct device         *device = adapter->Device;
   struct UPD_LIST_ENTRY *currentUPDVirtual = adapter->HeadUPDVirtual;
   DWORD  upPacketStatus;
   DWORD  frameLength;
-  BYTE  *socketBuffer;
+  int    entry, done = 0;
 
   DBGPRINT_RECEIVE (("UpCompleteEvent: IN\n"));
 
-  while (1)
+  /* Ring occupancy: the UPDs the NIC has filled and not yet handed back.
+   */
+  RING_HIWATER (adapter->RxRing.hiwater,
+                UpdsComplete (adapter, adapter->Resources.ReceiveCount));
+
+  while (done < budget)
   {
     /* If done with all UPDs break.
      */
@@ -2553,6 +2670,8 @@ STATIC void UpCompleteEvent (struct NIC_INFORMATION *adapter)
     if (!(upPacketStatus & UP_PACKET_STATUS_COMPLETE))
        break;
 
+    done++;
+
     /* Get the frame length from the UPD.
      */
     frameLength = currentUPDVirtual->UpPacketStatus & 0x1FFF;
@@ -2599,31 +2718,29 @@ STATIC void UpCompleteEvent (struct NIC_INFORMATION *adapter)
       }
     }
 
-    /* Try to allocate socket buffer
+    /* Check for Multicast before the buffer is handed over
      */
-    if (device->get_rx_buf &&
-        (socketBuffer = (*device->get_rx_buf) (frameLength)) != NULL)
     {
-      struct ETH_ADDR *EthAddr;
-
-      currentUPDVirtual->SGList[0].Address = VIRT_TO_PHYS (socketBuffer);
-      currentUPDVirtual->SGList[0].Count   = ETHERNET_MAXIMUM_FRAME_SIZE | 0x80000000;
-      currentUPDVirtual->RxBufferVirtual   = socketBuffer;
-
-      device->last_rx = jiffies;
-      currentUPDVirtual->SocketBuffer = socketBuffer;
+      struct ETH_ADDR *EthAddr = (struct ETH_ADDR*) currentUPDVirtual->RxBufferVirtual;
 
-      /* Check for Multicast
-       */
-      EthAddr = (struct ETH_ADDR*) currentUPDVirtual->SocketBuffer;
       if ((EthAddr->Addr[0] & ETH_MULTICAST_BIT) &&
           !(COMPARE_MACS (EthAddr, BroadcastAddr)))
          adapter->Statistics.Rx_MulticastPkts++;
     }
+
+    /* Pass the frame up; the UPD may get a fresh buffer in return
+     */
+    entry = currentUPDVirtual->RxRingIndex;
+    if (rx_ring_deliver (&adapter->RxRing, entry, frameLength))
+    {
+      device->last_rx = jiffies;
+      currentUPDVirtual->RxBufferVirtual   = rx_ring_buf (&adapter->RxRing, entry);
+      currentUPDVirtual->SGList[0].Address = VIRT_TO_PHYS (currentUPDVirtual->RxBufferVirtual);
+      currentUPDVirtual->SGList[0].Count   = ETHERNET_MAXIMUM_FRAME_SIZE | 0x80000000;
+    }
     else
     {
-      printk ("SKB allocation failed\n");
-      DBGPRINT_ERROR (("UpCompleteEvent: SKB allocation failed\n"));
+      DBGPRINT_ERROR (("UpCompleteEvent: no receive buffer\n"));
     }
     currentUPDVirtual->UpPacketStatus = 0;
     currentUPDVirtual = currentUPDVirtual->Next;
@@ -2631,6 +2748,7 @@ STATIC void UpCompleteEvent (struct NIC_INFORMATION *adapter)
   adapter->HeadUPDVirtual = currentUPDVirtual;
 
   DBGPRINT_RECEIVE (("UpCompleteEvent: OUT\n"));
+  return (done);
 }
 
 
@@ -2802,6 +2920,11 @@ STATIC void *NICGetStatistics (struct device *Device)
     stats->tx_fifo_errors   = 0;
     stats->tx_window_errors = 0;
 
+    stats->rx_ring_size    = adapter->Resources.ReceiveCount;
+    stats->rx_ring_hiwater = adapter->RxRing.hiwater;
+    stats->tx_ring_size    = adapter->Resources.SendCount;
+    stats->tx_ring_hiwater = adapter->TxRingHiwater;
+
     ENABLE();
   }
   return (void*)stats;
@@ -3449,11 +3572,11 @@ STATIC void IndicateToOSLinkStateChange (struct NIC_INFORMATION *adapter)
  
 
 /*
- * This routine handles the interrupt.
+ * This routine handles the interrupt. Returns TRUE if this adapter
+ * raised it.
  */
-STATIC void NICInterrupt (int Irq)
+STATIC int NICInterrupt (int Irq, struct device *Device)
 {
-  struct device          *Device  = irq2dev_map[Irq];
   struct NIC_INFORMATION *adapter = (struct NIC_INFORMATION*) Device->priv;
   WORD   intStatus = 0;
   BYTE   loopCount = 2;
@@ -3462,7 +3585,7 @@ STATIC void NICInterrupt (int Irq)
   if (Device->reentry)
   {
     printk ("%s: Re-enter the interrupt handler.\n", Device->name);
-    return;
+    return (FALSE);
   }
 
   Device->reentry = 1;
@@ -3472,7 +3595,7 @@ STATIC void NICInterrupt (int Irq)
   if (!(intStatus & INTSTATUS_INTERRUPT_LATCH))
   {
     Device->reentry = 0;
-    return;
+    return (FALSE);
   }
 
   /* Mask all the interrupts
@@ -3488,6 +3611,7 @@ STATIC void NICInterrupt (int Irq)
     intStatus = NIC_READ_PORT_WORD (adapter, INTSTATUS_COMMAND_REGISTER);
 
     intStatus &= INTSTATUS_INTERRUPT_MASK;
+    TRACE2 (TRC_DRVR, "%s: IntStatus %04X\n", Device->name, intStatus);
     if (!intStatus)
        break;
 
@@ -3509,7 +3633,29 @@ STATIC void NICInterrupt (int Irq)
     {
       NIC_COMMAND (adapter, COMMAND_ACKNOWLEDGE_INTERRUPT |
                              ACKNOWLEDGE_UP_COMPLETE);
-      UpCompleteEvent (adapter);
+
+      /* In polled mode NICPoll() empties the ring. When coalescing
+       * and fewer than CoalFrames UPDs are done, wait for the count-down
+       * interrupt. Otherwise empty the ring here and switch to polling
+       * if this was a burst and the capture layer calls netif_poll().
+       */
+      if (!Device->polling)
+      {
+        if (adapter->CoalFrames > 1 && !adapter->RxDeferred &&
+            UpdsComplete (adapter, adapter->CoalFrames) < adapter->CoalFrames)
+        {
+          adapter->RxDeferred = TRUE;
+          NIC_WRITE_PORT_WORD (adapter, COUNTDOWN_REGISTER,
+                               (WORD) COUNTDOWN_TICKS (adapter->CoalUsecs));
+        }
+        else
+        {
+          adapter->RxDeferred = FALSE;
+          if (UpCompleteEvent (adapter, adapter->Resources.ReceiveCount) >= NIC_RX_POLL_BURST &&
+              Device->poll_ok)
+             netif_rx_schedule (Device);
+        }
+      }
     }
 
     if (intStatus & INTSTATUS_INTERRUPT_REQUESTED)
@@ -3518,6 +3664,13 @@ STATIC void NICInterrupt (int Irq)
                              ACKNOWLEDGE_INTERRUPT_REQUESTED);
       CountDownTimerEvent (adapter);
       countDownTimerEventCalled = TRUE;
+
+      if (adapter->RxDeferred)
+      {
+        adapter->RxDeferred = FALSE;
+        if (!Device->polling)
+           UpCompleteEvent (adapter, adapter->Resources.ReceiveCount);
+      }
     }
 
     if (intStatus & INTSTATUS_TX_COMPLETE)
@@ -3534,8 +3687,70 @@ STATIC void NICInterrupt (int Irq)
       countDownTimerEventCalled = TRUE;
     }
   }
-  NIC_UNMASK_ALL_INTERRUPT (adapter);
+  if (Device->polling || adapter->RxDeferred)
+       NIC_UNMASK_ALL_BUT_UP_COMPLETE (adapter);
+  else NIC_UNMASK_ALL_INTERRUPT (adapter);
   Device->reentry = 0;
+  return (TRUE);
+}
+
+
+/*
+ * Count completed UPDs at the head of the ring, up to 'max'.
+ */
+STATIC int UpdsComplete (struct NIC_INFORMATION *adapter, int max)
+{
+  struct UPD_LIST_ENTRY *upd = adapter->HeadUPDVirtual;
+  int    num = 0;
+
+  while (num < max && (upd->UpPacketStatus & UP_PACKET_STATUS_COMPLETE))
+  {
+    num++;
+    upd = upd->Next;
+  }
+  return (num);
+}
+
+/*
+ * Coalescing hook (dev->set_coalesce). The NIC has no receive
+ * mitigation of its own, so a receive interrupt with fewer than
+ * 'Frames' UPDs done is deferred up to 'Usecs' on the count-down
+ * timer.
+ */
+STATIC int NICSetCoalesce (struct device *Device, int Frames, int Usecs)
+{
+  struct NIC_INFORMATION *adapter = (struct NIC_INFORMATION*) Device->priv;
+
+  /* Keep the old CoalUsecs if turned off; a deferred receive may
+   * still be waiting on it.
+   */
+  if (Usecs > 0)
+  {
+    adapter->CoalUsecs  = Usecs;
+    adapter->CoalFrames = Frames;
+  }
+  else
+    adapter->CoalFrames = 0;
+  return (0);
+}
+
+/*
+ * Polled receive; called via netif_poll() while Rx interrupts are
+ * masked. Unmask them again when the ring is drained.
+ */
+STATIC int NICPoll (struct device *Device, int Budget)
+{
+  struct NIC_INFORMATION *adapter = (struct NIC_INFORMATION*) Device->priv;
+  int    done = UpCompleteEvent (adapter, Budget);
+
+  if (done < Budget)
+  {
+    DISABLE();
+    netif_rx_complete (Device);
+    NIC_UNMASK_ALL_INTERRUPT (adapter);
+    ENABLE();
+  }
+  return (done);
 }
 
 
@@ -3660,14 +3875,13 @@ STATIC void CountDownTimerEvent (struct NIC_INFORMATION *adapter)
     if (!(headDPDVirtual->FrameStartHeader & FSH_DOWN_COMPLETE))
        break;
 
-    ASSERT (headDPDVirtual->SocketBuffer != NULL);
-    k_free (headDPDVirtual->SocketBuffer);
-    headDPDVirtual->SocketBuffer = NULL;
+    CompleteDPD (headDPDVirtual, TRUE);
 
     /* Clear the down complete bit in the frame start header.
      */
     headDPDVirtual->FrameStartHeader = 0;
     adapter->BytesInDPDQueue -= headDPDVirtual->PacketLength;
+    adapter->TxRingUsed--;
     headDPDVirtual = headDPDVirtual->Next;
     ASSERT (adapter->HeadDPDVirtual != NULL);
   }
@@ -3696,6 +3910,10 @@ STATIC void NICTimer (DWORD Data)
   struct NIC_INFORMATION *adapter = (struct NIC_INFORMATION*) device->priv;
 
   adapter->InTimer = TRUE;
+  netif_coalesce_tune (device, adapter->RxRing.swapped +
+                               adapter->RxRing.copied  +
+                               adapter->RxRing.dropped);
+
   adapter->Statistics.UpdateInterval += adapter->Resources.TimerInterval;
   if (adapter->Statistics.UpdateInterval > 1000)
   {
@@ -4759,6 +4977,9 @@ STATIC DWORD ReadCommandLineChanges (struct NIC_INFORMATION *adapter)
 
   DBGPRINT_INIT (("ReadCommandLineChanges: IN index=%x\n", index));
 
+  tc90x_SendCount[index]    = ring_param (TX_RING_PARAM, index, tc90x_SendCount[index]);
+  tc90x_ReceiveCount[index] = ring_param (RX_RING_PARAM, index, tc90x_ReceiveCount[index]);
+
   if (tc90x_SendCount[index] < NIC_MINIMUM_SEND_COUNT ||
       tc90x_SendCount[index] > NIC_MAXIMUM_SEND_COUNT)
   {
@@ -534,8 +534,10 @@ typedef struct DPD_LIST_ENTRY {
         struct DPD_LIST_ENTRY      *Next;
         struct DPD_LIST_ENTRY      *Previous;
         DWORD                       DPDPhysicalAddress;
-        BYTE                       *SocketBuffer;
+        BYTE                       *TxBuffer;   /* for NICSendPacket() */
         DWORD                       PacketLength;
+        tx_done_fn                  TxDone;     /* for NICSendFrags() */
+        void                       *TxArg;
       } DPD_LIST_ENTRY;
 
 
@@ -547,7 +549,7 @@ typedef struct UPD_LIST_ENTRY {
         struct UPD_LIST_ENTRY      *Previous;
         DWORD                       UPDPhysicalAddress;
         BYTE                       *RxBufferVirtual;
-        BYTE                       *SocketBuffer;
+        int                         RxRingIndex;
       } UPD_LIST_ENTRY;
 
 
@@ -760,7 +762,12 @@ typedef struct NIC_HARDWARE_INFORMATION {
 #define NIC_MINIMUM_SEND_COUNT		0x2
 #define NIC_MAXIMUM_SEND_COUNT		0x80
 #define NIC_MINIMUM_RECEIVE_COUNT	0x2
-#define NIC_MAXIMUM_RECEIVE_COUNT	0x80
+#define NIC_MAXIMUM_RECEIVE_COUNT	0x400
+#define NIC_RX_POLL_BURST		8	/* UPDs per interrupt to start polling */
+
+/* The count-down timer ticks every 3.2 usec.
+ */
+#define COUNTDOWN_TICKS(usec)		(((DWORD)(usec) * 10 + 31) / 32)
 
 #define LINK_SPEED_100			100000000L
 #define LINK_SPEED_10			10000000L
@@ -861,6 +868,12 @@ typedef struct NIC_INFORMATION {
 
         struct NIC_PCI_INFORMATION  PCI;
         struct UPD_LIST_ENTRY      *HeadUPDVirtual;
+        struct rx_ring              RxRing;
+        int                         TxRingUsed;
+        int                         TxRingHiwater;
+        int                         CoalFrames;
+        int                         CoalUsecs;
+        BOOL                        RxDeferred;
         struct DPD_LIST_ENTRY      *HeadDPDVirtual;
         struct DPD_LIST_ENTRY      *TailDPDVirtual;
 
@@ -918,6 +931,12 @@ typedef struct NIC_INFORMATION {
         NIC_READ_PORT_WORD (pAdapter, INTSTATUS_COMMAND_REGISTER); \
       } while (0)
 
+#define NIC_UNMASK_ALL_BUT_UP_COMPLETE(pAdapter) do { \
+        NIC_COMMAND (pAdapter, COMMAND_SET_INTERRUPT_ENABLE | \
+                     (ENABLE_ALL_INTERRUPT & ~INTSTATUS_UP_COMPLETE)); \
+        NIC_READ_PORT_WORD (pAdapter, INTSTATUS_COMMAND_REGISTER); \
+      } while (0)
+
 
 #define NIC_ACKNOWLEDGE_ALL_INTERRUPT(pAdapter) \
         NIC_COMMAND (pAdapter, COMMAND_ACKNOWLEDGE_INTERRUPT | ACKNOWLEDGE_ALL_INTERRUPT)
@@ -1017,6 +1036,12 @@ __inline static void SetCountDownTimer (struct NIC_INFORMATION *pAdapter)
   if (countDownValue < 10)
       countDownValue = 10;
 
+  /* Don't push out a pending deferred receive.
+   */
+  if (pAdapter->RxDeferred &&
+      countDownValue > COUNTDOWN_TICKS (pAdapter->CoalUsecs))
+      countDownValue = COUNTDOWN_TICKS (pAdapter->CoalUsecs);
+
   NIC_WRITE_PORT_WORD (pAdapter, COUNTDOWN_REGISTER, (WORD)countDownValue);
 }
 
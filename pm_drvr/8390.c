@@ -569,12 +569,34 @@ static void ei_receive (struct device *dev)
     }
     else if ((rx_frame.status & 0x0F) == ENRSR_RXOK)
     {
-      if (dev->get_rx_buf)
+      int   ofs  = current_offset + sizeof(rx_frame);
+      int   peek = rx_peek_size (dev, len);
+      DWORD hdr [RX_PEEK_MAX/4];
+
+      /* Read the header only. A rejected frame is skipped by moving
+       * the boundary below; the rest never crosses the bus.
+       */
+      if (peek)
+         (*ei_block_input) (dev, peek, (char*)hdr, ofs);
+
+      if (peek && !(*dev->rx_prefilter) ((const BYTE*)hdr, peek, len))
+         ei_local->stat.rx_prefiltered++;
+
+      else if (dev->get_rx_buf)
       {
         char *buf = (*dev->get_rx_buf) (len);
 
         if (buf)
-             (*ei_block_input) (dev, len, buf, current_offset + sizeof(rx_frame));
+        {
+          if (peek)
+          {
+            memcpy (buf, hdr, peek);
+            ofs += peek;
+            if (ofs >= ei_local->stop_page << 8)   /* wrap the ring */
+               ofs -= num_rx_pages << 8;
+          }
+          (*ei_block_input) (dev, len - peek, buf + peek, ofs);
+        }
         else ei_local->stat.rx_dropped++;
       }
       ei_local->stat.rx_bytes += len;
@@ -846,6 +846,9 @@ int pcibios_present (void)
 
 int pcibios_find_class (unsigned class_code, WORD index, BYTE *bus, BYTE *device_fn)
 {
+  if (pci_snap_active())
+     return pci_snap_find_class (class_code, index, bus, device_fn);
+
   if (access_pci && access_pci->find_class)
      return (*access_pci->find_class) (class_code, index, bus, device_fn);
 
@@ -855,6 +858,9 @@ int pcibios_find_class (unsigned class_code, WORD index, BYTE *bus, BYTE *device
 int pcibios_find_device (WORD vendor, WORD device_id,
                          WORD index, BYTE *bus, BYTE *device_fn)
 {
+  if (pci_snap_active())
+     return pci_snap_find_device (vendor, device_id, index, bus, device_fn);
+
   if (access_pci && access_pci->find_device)
      return (*access_pci->find_device) (vendor, device_id, index, bus, device_fn);
 
@@ -863,6 +869,13 @@ int pcibios_find_device (WORD vendor, WORD device_id,
 
 int pcibios_read_config_byte (BYTE bus, BYTE device_fn, BYTE where, BYTE *value)
 {
+  DWORD val;
+
+  if (pci_snap_read (bus, device_fn, where, 1, &val))
+  {
+    *value = (BYTE) val;
+    return (PCIBIOS_SUCCESSFUL);
+  }
   if (access_pci && access_pci->read_config_byte)
      return (*access_pci->read_config_byte) (bus, device_fn, where, value);
 
@@ -871,6 +884,13 @@ int pcibios_read_config_byte (BYTE bus, BYTE device_fn, BYTE where, BYTE *value)
 
 int pcibios_read_config_word (BYTE bus, BYTE device_fn, BYTE where, WORD *value)
 {
+  DWORD val;
+
+  if (pci_snap_read (bus, device_fn, where, 2, &val))
+  {
+    *value = (WORD) val;
+    return (PCIBIOS_SUCCESSFUL);
+  }
   if (access_pci && access_pci->read_config_word)
      return (*access_pci->read_config_word) (bus, device_fn, where, value);
 
@@ -878,6 +898,17 @@ int pcibios_read_config_word (BYTE bus, BYTE device_fn, BYTE where, WORD *value)
 }
 
 int pcibios_read_config_dword (BYTE bus, BYTE device_fn, BYTE where, DWORD *value)
+{
+  if (pci_snap_read (bus, device_fn, where, 4, value))
+     return (PCIBIOS_SUCCESSFUL);
+
+  return pcibios_read_config_raw (bus, device_fn, where, value);
+}
+
+/*
+ * Read a dword from the hardware, never from the PCI snapshot.
+ */
+int pcibios_read_config_raw (BYTE bus, BYTE device_fn, BYTE where, DWORD *value)
 {
   if (access_pci && access_pci->read_config_dword)
      return (*access_pci->read_config_dword) (bus, device_fn, where, value);
@@ -887,6 +918,8 @@ int pcibios_read_config_dword (BYTE bus, BYTE device_fn, BYTE where, DWORD *valu
 
 int pcibios_write_config_byte (BYTE bus, BYTE device_fn, BYTE where, BYTE value)
 {
+  pci_snap_write (bus, device_fn, where);
+
   if (access_pci && access_pci->write_config_byte)
      return (*access_pci->write_config_byte) (bus, device_fn, where, value);
 
@@ -895,6 +928,8 @@ int pcibios_write_config_byte (BYTE bus, BYTE device_fn, BYTE where, BYTE value)
 
 int pcibios_write_config_word (BYTE bus, BYTE device_fn, BYTE where, WORD value)
 {
+  pci_snap_write (bus, device_fn, where);
+
   if (access_pci && access_pci->write_config_word)
      return (*access_pci->write_config_word) (bus, device_fn, where, value);
 
@@ -903,6 +938,8 @@ int pcibios_write_config_word (BYTE bus, BYTE device_fn, BYTE where, WORD value)
 
 int pcibios_write_config_dword (BYTE bus, BYTE device_fn, BYTE where, DWORD value)
 {
+  pci_snap_write (bus, device_fn, where);
+
   if (access_pci && access_pci->write_config_dword)
      return (*access_pci->write_config_dword) (bus, device_fn, where, value);
 
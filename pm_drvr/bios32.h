@@ -56,6 +56,8 @@ int   pcibios_write_config_word (BYTE bus, BYTE dev_fn,
                                  BYTE where, WORD val);
 int   pcibios_write_config_dword(BYTE bus, BYTE dev_fn,
                                  BYTE where, DWORD val);
+int   pcibios_read_config_raw   (BYTE bus, BYTE dev_fn,
+                                 BYTE where, DWORD *val);
 const char *pcibios_strerror (int error);
 
 #endif /* BIOS32_H */
@@ -127,32 +127,273 @@ static DMA_ENTRY mydma[] LOCKED_VAR =
 
 
 
-/* _dma_allocate:
- *  Allocates the specified amount of conventional memory, ensuring that
- *  the returned block doesn't cross a page boundary. Sel will be set to
- *  the protected mode segment that should be used to free the block, and
- *  phys to the linear address of the block. On error, returns non-zero
- *  and sets sel and phys to 0.
+/* The DMA pool. Free pieces are kept sorted by address so a freed
+ * buffer can be merged with its neighbours.
  */
-int _dma_allocate (int bytes, int *sel, DWORD *phys)
+struct dma_piece {
+   DWORD phys;
+   DWORD size;
+};
+
+static struct dma_piece pool_free [DMA_POOL_PIECES];
+static struct dma_piece pool_used [DMA_POOL_PIECES];
+static int              num_free = 0;
+static int              num_used = 0;
+static int              pool_sel [DMA_POOL_BLOCKS];
+static DWORD            bounce [DMA_BOUNCE_MAX];
+static struct dma_pool_stats pool_stats;
+
+
+/* pool_give:
+ *  Returns a piece to the free list, merging it with its neighbours.
+ *  Returns 0 if the list is full and the piece is lost.
+ */
+static int pool_give (DWORD phys, DWORD size)
 {
-   int seg;
+   int i;
+
+   for (i = 0; i < num_free && pool_free[i].phys < phys; i++)
+      ;
+
+   if (i > 0 && pool_free[i-1].phys + pool_free[i-1].size == phys) {
+      pool_free[i-1].size += size;
+      if (i < num_free && phys + size == pool_free[i].phys) {
+         pool_free[i-1].size += pool_free[i].size;
+         num_free--;
+         memmove (&pool_free[i], &pool_free[i+1], (num_free-i) * sizeof(pool_free[0]));
+      }
+      return 1;
+   }
 
-   /* allocate twice as much memory as we really need */
-   seg = __dpmi_allocate_dos_memory((bytes*2 + 15) >> 4, sel);
+   if (i < num_free && phys + size == pool_free[i].phys) {
+      pool_free[i].phys  = phys;
+      pool_free[i].size += size;
+      return 1;
+   }
 
-   if (seg < 0) {
-      *sel = 0;
-      *phys = 0;
-      return -1;
+   if (num_free == DMA_POOL_PIECES)
+      return 0;
+
+   memmove (&pool_free[i+1], &pool_free[i], (num_free-i) * sizeof(pool_free[0]));
+   pool_free[i].phys = phys;
+   pool_free[i].size = size;
+   num_free++;
+   return 1;
+}
+
+
+/* pool_take:
+ *  Carves 'size' bytes aligned to 'align' out of the first free piece
+ *  that holds them without crossing a 64kB page. Returns 0 if none does.
+ */
+static DWORD pool_take (DWORD size, DWORD align)
+{
+   int i;
+
+   for (i = 0; i < num_free; i++) {
+      DWORD start = pool_free[i].phys;
+      DWORD end   = start + pool_free[i].size;
+      DWORD addr  = (start + align - 1) & ~(align - 1);
+
+      if ((addr >> 16) != ((addr + size - 1) >> 16))
+         addr = (addr + 0xFFFF) & ~0xFFFF;     /* start of next page */
+
+      if (addr + size > end)
+         continue;
+
+      if (addr > start && addr + size < end) { /* split in two */
+         if (num_free == DMA_POOL_PIECES)
+            continue;
+         memmove (&pool_free[i+2], &pool_free[i+1],
+                  (num_free-i-1) * sizeof(pool_free[0]));
+         num_free++;
+         pool_free[i].size   = addr - start;
+         pool_free[i+1].phys = addr + size;
+         pool_free[i+1].size = end - addr - size;
+      }
+      else if (addr > start)
+         pool_free[i].size = addr - start;
+      else if (addr + size < end) {
+         pool_free[i].phys = addr + size;
+         pool_free[i].size = end - addr - size;
+      }
+      else {
+         num_free--;
+         memmove (&pool_free[i], &pool_free[i+1], (num_free-i) * sizeof(pool_free[0]));
+      }
+      return addr;
+   }
+   return 0;
+}
+
+
+/* pool_grow:
+ *  Adds a DOS memory block big enough for a 'size' byte buffer aligned
+ *  to 'align', wherever the 64kB pages fall in it.
+ */
+static int pool_grow (DWORD size, DWORD align)
+{
+   DWORD len = 2 * size + align;
+   int   seg, sel;
+
+   if (pool_stats.blocks == DMA_POOL_BLOCKS)
+      return 0;
+
+   if (len < DMA_POOL_BLOCK)
+      len = DMA_POOL_BLOCK;
+   len = (len + 15) & ~15;
+
+   seg = __dpmi_allocate_dos_memory (len >> 4, &sel);
+   if (seg < 0)
+      return 0;
+
+   if (!pool_give (seg << 4, len)) {
+      __dpmi_free_dos_memory (sel);
+      return 0;
+   }
+   pool_sel [pool_stats.blocks++] = sel;
+   pool_stats.reserved += len;
+   return 1;
+}
+
+
+/* dma_pool_alloc:
+ *  Returns the physical address of a buffer of 'bytes' (at most 64kB)
+ *  in conventional memory that doesn't cross a 64kB page, aligned to
+ *  'align' (a power of 2; at least 16). Returns 0 on failure.
+ */
+DWORD dma_pool_alloc (int bytes, int align)
+{
+   DWORD size, phys;
+
+   if (align < 16)
+      align = 16;
+
+   if (bytes <= 0 || bytes > 0x10000 || (align & (align-1)) ||
+       num_used == DMA_POOL_PIECES) {
+      pool_stats.failed++;
+      return 0;
+   }
+
+   size = (bytes + 15) & ~15;
+   phys = pool_take (size, align);
+   if (!phys && pool_grow (size, align))
+      phys = pool_take (size, align);
+
+   if (!phys) {
+      pool_stats.failed++;
+      return 0;
    }
 
-   *phys = seg << 4;
+   pool_used[num_used].phys = phys;
+   pool_used[num_used].size = size;
+   num_used++;
+
+   pool_stats.allocs++;
+   pool_stats.in_use += size;
+   if (pool_stats.in_use > pool_stats.peak)
+      pool_stats.peak = pool_stats.in_use;
+   return phys;
+}
+
+
+/* dma_pool_free:
+ *  Returns a buffer from dma_pool_alloc() to the pool.
+ */
+void dma_pool_free (DWORD phys)
+{
+   int i;
+
+   for (i = 0; i < num_used; i++)
+      if (pool_used[i].phys == phys)
+         break;
+
+   if (i == num_used)
+      return;
+
+   pool_give (phys, pool_used[i].size);
+   pool_stats.in_use -= pool_used[i].size;
+   pool_used[i] = pool_used[--num_used];
+}
 
-   /* if it crosses a page boundary, use the second half of the block */
-   if ((*phys>>16) != ((*phys+bytes)>>16))
-      *phys += bytes;
 
+/* dma_bounce_get:
+ *  Returns a DMA_BOUNCE_SIZE buffer for data that lies where the 8237
+ *  or a 24-bit bus-master can't reach it, or 0 if there is no memory.
+ *  They are made DMA_BOUNCE_NUM at a time.
+ */
+DWORD dma_bounce_get (void)
+{
+   DWORD phys;
+
+   while (pool_stats.bounce_free < DMA_BOUNCE_NUM) {
+      phys = dma_pool_alloc (DMA_BOUNCE_SIZE, 16);
+      if (!phys)
+         break;
+      bounce [pool_stats.bounce_free++] = phys;
+   }
+
+   if (!pool_stats.bounce_free)
+      return 0;
+   return bounce [--pool_stats.bounce_free];
+}
+
+
+/* dma_bounce_put:
+ *  Gives back a buffer from dma_bounce_get().
+ */
+void dma_bounce_put (DWORD phys)
+{
+   if (pool_stats.bounce_free < DMA_BOUNCE_MAX)
+      bounce [pool_stats.bounce_free++] = phys;
+   else
+      dma_pool_free (phys);
+}
+
+
+const struct dma_pool_stats *dma_pool_stats (void)
+{
+   return &pool_stats;
+}
+
+
+/* dma_pool_report:
+ *  Prints how much of the pool is used.
+ */
+void dma_pool_report (void)
+{
+   DWORD largest = 0;
+   int   i;
+
+   for (i = 0; i < num_free; i++)
+      if (pool_free[i].size > largest)
+         largest = pool_free[i].size;
+
+   printk ("dma pool: %d blocks, %lu bytes, %lu in use (peak %lu)\n",
+           pool_stats.blocks, pool_stats.reserved, pool_stats.in_use,
+           pool_stats.peak);
+   printk ("dma pool: %lu buffers given, %lu failed, %d bounce buffers ready, "
+           "%d free pieces (largest %lu)\n", pool_stats.allocs,
+           pool_stats.failed, pool_stats.bounce_free, num_free, largest);
+}
+
+
+/* _dma_allocate:
+ *  Allocates the specified amount of conventional memory from the DMA
+ *  pool, ensuring that the returned block doesn't cross a page boundary.
+ *  Sel will be set to a selector for all of conventional memory (the
+ *  offset is phys), and phys to the linear address of the block. Free
+ *  the block with dma_pool_free(). On error, returns non-zero and sets
+ *  sel and phys to 0.
+ */
+int _dma_allocate (int bytes, int *sel, DWORD *phys)
+{
+   *phys = dma_pool_alloc (bytes, 16);
+   if (!*phys) {
+      *sel = 0;
+      return -1;
+   }
+   *sel = _dos_ds;
    return 0;
 }
 
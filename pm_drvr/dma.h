@@ -7,6 +7,37 @@ void  _dma_stop     (int ch)                          LOCKED_FUNC;
 DWORD _dma_todo     (int ch)                          LOCKED_FUNC;
 int   _dma_request  (int ch, const char *dev_name);
 
+/*
+ * DMA memory pool. Buffers for the 8237 and ISA bus-masters are carved
+ * out of a few large DOS memory blocks; none crosses a 64kB page. The
+ * buffers are given by their physical (linear) address; access them
+ * with memcpy_toio()/memcpy_fromio() or through _dos_ds. Not for use
+ * at interrupt time.
+ */
+#define DMA_POOL_BLOCK    0x4000  /* bytes of DOS memory taken at a time */
+#define DMA_POOL_BLOCKS   8
+#define DMA_POOL_PIECES   64      /* free pieces and buffers kept track of */
+#define DMA_BOUNCE_SIZE   1600    /* a bounce buffer holds any frame */
+#define DMA_BOUNCE_NUM    4       /* bounce buffers made at a time */
+#define DMA_BOUNCE_MAX    16
+
+struct dma_pool_stats {
+       int    blocks;             /* DOS blocks taken             */
+       DWORD  reserved;           /* their total size             */
+       DWORD  in_use;             /* bytes given out              */
+       DWORD  peak;
+       DWORD  allocs;
+       DWORD  failed;
+       int    bounce_free;        /* ready-made bounce buffers    */
+     };
+
+DWORD dma_pool_alloc  (int bytes, int align);
+void  dma_pool_free   (DWORD phys);
+DWORD dma_bounce_get  (void);
+void  dma_bounce_put  (DWORD phys);
+void  dma_pool_report (void);
+const struct dma_pool_stats *dma_pool_stats (void);
+
 /* $Id: dma.h,v 1.7 1992/12/14 00:29:34 root Exp root $
  * linux/include/asm/dma.h: Defines for using and allocating dma channels.
  * Written by Hennus Bergman, 1992.
@@ -0,0 +1,243 @@
+/*
+ *  hwfilt.c - Let the NIC's address filter do the work of a capture
+ *             filter.
+ *
+ *  If every frame a BPF program accepts must have one of a few
+ *  destination addresses, the NIC can be told to receive only those
+ *  instead of running promiscuous. Unwanted frames then never cross
+ *  the bus. The program still runs in software, so the NIC need only
+ *  pass a superset of what the program accepts.
+ */
+
+#include "pmdrvr.h"
+#include "module.h"
+
+#define HWF_MAX_STEPS  2000  /* give up on programs with too many paths */
+
+/*
+ * What is known along one path through the program.
+ */
+struct hwf_state {
+       BYTE  addr  [ETH_ALEN];  /* destination bytes known so far  */
+       BYTE  known [ETH_ALEN];  /* non-zero if addr[i] is known    */
+       int   a_ofs;             /* A holds destination bytes       */
+       int   a_size;            /* [a_ofs, a_ofs+a_size); 0 = other */
+     };
+
+struct hwf_result {
+       struct device *dev;
+       ETHER  addr [MAX_MCAST]; /* multicast groups accepted       */
+       int    num;
+       int    all_multi;        /* more groups than 'addr' holds   */
+       int    steps;
+     };
+
+/*
+ * Add "A == k" to 'st'. Returns -1 if that contradicts what is known
+ * (the jump is never taken), 0 if it was known already (the jump is
+ * always taken) or 1 if it pinned new bytes.
+ */
+static int hwf_pin (struct hwf_state *st, DWORD k)
+{
+  int i, pinned = 0;
+
+  if (st->a_size < 4 && (k >> (8 * st->a_size)))
+     return (-1);
+
+  for (i = st->a_size - 1; i >= 0; i--, k >>= 8)  /* network order */
+  {
+    int  ofs  = st->a_ofs + i;
+    BYTE byte = (BYTE) k;
+
+    if (!st->known[ofs])
+    {
+      st->known[ofs] = 1;
+      st->addr[ofs]  = byte;
+      pinned = 1;
+    }
+    else if (st->addr[ofs] != byte)
+      return (-1);
+  }
+  return (pinned);
+}
+
+/*
+ * A path ends in an accepting 'ret'. Returns 0 if the NIC can't be
+ * set up to pass the frames it accepts.
+ */
+static int hwf_accept (const struct hwf_state *st, struct hwf_result *res)
+{
+  int i;
+
+  for (i = 0; i < ETH_ALEN; i++)
+      if (!st->known[i])
+         return (0);
+
+  if (!(st->addr[0] & 1))   /* unicast; only our own passes the NIC */
+     return (memcmp (st->addr, res->dev->dev_addr, ETH_ALEN) == 0);
+
+  if (!memcmp (st->addr, res->dev->broadcast, ETH_ALEN))
+     return (1);
+
+  for (i = 0; i < res->num; i++)
+      if (!memcmp (st->addr, res->addr[i], ETH_ALEN))
+         return (1);
+
+  if (res->num < MAX_MCAST)
+       memcpy (res->addr[res->num++], st->addr, ETH_ALEN);
+  else res->all_multi = 1;
+  return (1);
+}
+
+/*
+ * Follow every path from 'pc'. Returns 0 if some path accepts frames
+ * without pinning the destination address to one we can filter on.
+ * BPF only jumps forward, so this always ends.
+ */
+static int hwf_walk (const struct bpf_insn *prog, int len, int pc,
+                     struct hwf_state st, struct hwf_result *res)
+{
+  for ( ; pc < len; pc++)
+  {
+    const struct bpf_insn *insn = prog + pc;
+    struct hwf_state eq;
+
+    if (++res->steps > HWF_MAX_STEPS)
+       return (0);
+
+    switch (BPF_CLASS(insn->code))
+    {
+      case BPF_RET:
+           if (BPF_RVAL(insn->code) == BPF_K && insn->k == 0)
+              return (1);              /* frame rejected */
+           return hwf_accept (&st, res);
+
+      case BPF_LD:
+           st.a_size = 0;
+           if (BPF_MODE(insn->code) == BPF_ABS)
+           {
+             int size = BPF_SIZE(insn->code) == BPF_W ? 4 :
+                        BPF_SIZE(insn->code) == BPF_H ? 2 : 1;
+
+             if (insn->k < ETH_ALEN && insn->k + size <= ETH_ALEN)
+             {
+               st.a_ofs  = insn->k;
+               st.a_size = size;
+             }
+           }
+           break;
+
+      case BPF_ALU:
+           st.a_size = 0;
+           break;
+
+      case BPF_MISC:
+           if (BPF_MISCOP(insn->code) == BPF_TXA)
+              st.a_size = 0;
+           break;
+
+      case BPF_JMP:
+           if (BPF_OP(insn->code) == BPF_JA)
+           {
+             if (insn->k >= (DWORD)(len - pc - 1))
+                return (0);             /* jumps out of the program */
+             pc += insn->k;
+             break;
+           }
+           if (BPF_OP(insn->code) == BPF_JEQ && BPF_SRC(insn->code) == BPF_K &&
+               st.a_size)
+           {
+             eq = st;
+             switch (hwf_pin (&eq, insn->k))
+             {
+               case -1:                 /* only the false branch */
+                    pc += insn->jf;
+                    break;
+               case 0:                  /* only the true branch */
+                    pc += insn->jt;
+                    break;
+               default:
+                    if (!hwf_walk (prog, len, pc + 1 + insn->jt, eq, res))
+                       return (0);
+                    pc += insn->jf;
+                    break;
+             }
+             break;
+           }
+
+           /* Any other test; both branches may be taken.
+            */
+           if (!hwf_walk (prog, len, pc + 1 + insn->jt, st, res))
+              return (0);
+           pc += insn->jf;
+           break;
+
+      default:                          /* LDX, ST, STX */
+           break;
+    }
+  }
+  return (0);   /* ran off the end; not a valid program */
+}
+
+/*
+ * Save the device's address filter before the first offload.
+ */
+static void hwf_save (struct device *dev)
+{
+  if (dev->hwf_saved)
+     return;
+  dev->hwf_flags    = dev->flags;
+  dev->hwf_mc_count = dev->mc_count;
+  memcpy (dev->hwf_mc_list, dev->mc_list, sizeof(dev->mc_list));
+  dev->hwf_saved = 1;
+}
+
+/*
+ * Put back the address filter saved by hwf_save(), if any.
+ */
+static void hwf_restore (struct device *dev)
+{
+  if (!dev->hwf_saved)
+     return;
+  dev->flags    = dev->hwf_flags;
+  dev->mc_count = dev->hwf_mc_count;
+  memcpy (dev->mc_list, dev->hwf_mc_list, sizeof(dev->mc_list));
+  dev->hwf_saved = 0;
+  (*dev->set_multicast_list) (dev);
+}
+
+/*
+ * Try to use the NIC's address filter instead of promiscuous mode
+ * for capture filter 'prog' of 'len' instructions. Call it after the
+ * device is opened, and again whenever the filter changes. Returns 1
+ * if the NIC filter was set up, or 0 if the device has the address
+ * filter it had before the first offload.
+ */
+int netif_filter_offload (struct device *dev, const struct bpf_insn *prog, int len)
+{
+  struct hwf_state  st;
+  struct hwf_result res;
+
+  if (!dev->set_multicast_list)
+     return (0);
+
+  memset (&st, 0, sizeof(st));
+  memset (&res, 0, sizeof(res));
+  res.dev = dev;
+
+  if (!prog || len <= 0 || !hwf_walk (prog, len, 0, st, &res))
+  {
+    hwf_restore (dev);
+    return (0);
+  }
+
+  hwf_save (dev);
+  memcpy (dev->mc_list, res.addr, res.num * sizeof(ETHER));
+  dev->mc_count = res.num;
+  dev->flags &= ~(IFF_PROMISC | IFF_ALLMULTI);
+  if (res.all_multi)
+     dev->flags |= IFF_ALLMULTI;
+
+  (*dev->set_multicast_list) (dev);
+  return (1);
+}
@@ -31,6 +31,7 @@
 
 #include "pmdrvr.h"
 #include "module.h"
+#include "trace.h"
 
 /*
  * IRQ handling partially based on:
@@ -56,13 +57,19 @@ DWORD irq_stub_stacks [NUM_IRQS] LOCKED_VAR = { 0 };
 
 void irq_umbrella_handler (int irq) LOCKED_FUNC;
 
+static void irq_run_chain (int irq) LOCKED_FUNC;
+
 struct irq_info {
        void              (*new_handler)(int);
        _go32_dpmi_seginfo  old_handler;
        _go32_dpmi_seginfo  wrapper;
        int                 used;
        int                 eoi_done;
+       int                 flags;          /* IRQ_FPU */
+       struct irq_action  *action;         /* shared handler chain */
+       DWORD               unclaimed;      /* no handler on chain claimed it */
        BYTE                old_mask;
+       BYTE                fpu_state[108]; /* FNSAVE area */
      };
 
 static struct  irq_info irq_cfg [NUM_IRQS] LOCKED_VAR;
@@ -72,9 +79,13 @@ static          DWORD irq_handled; /* The irq lines we have a handler for. */
 static volatile DWORD irq_bitmap;  /* The irqs we actually found. */
 static volatile DWORD irq_active;  /* irq umbrella handler nesting level */
 static volatile int   irq_number;  /* The latest irq number we actually found */
-static unsigned int   fpu_state[200];
 static int            have_fpu;
 
+#ifdef IRQ_FPU_TRAP
+static int          fpu_cp_flags LOCKED_VAR;      /* DPMI coprocessor flags (MP/EM) */
+static volatile int fpu_trap_irq LOCKED_VAR = -1; /* IRQ of handler being trapped */
+#endif
+
 static void (*irq_stubs [NUM_IRQS]) (void) = {
               pcap_irq_stub_0,  pcap_irq_stub_1,
               pcap_irq_stub_2,  pcap_irq_stub_3,
@@ -209,10 +220,59 @@ int autoirq_report (int usec)
   return (irq_number);
 }
 
+#ifdef IRQ_FPU_TRAP
+/*
+ * Debug aid: a DPMI client can't set CR0.TS itself, but turning on
+ * coprocessor emulation (CR0.EM) gives the same #NM fault on the
+ * first FPU instruction. djgpp turns that into SIGNOFP.
+ */
+static void fpu_trap_handler (int sig)
+{
+  __dpmi_set_coprocessor_emulation (fpu_cp_flags);
+  printk ("irq: IRQ%d handler used the FPU without IRQ_FPU\n", fpu_trap_irq);
+  signal (sig, SIG_DFL);
+  raise (sig);
+}
+
+static void fpu_trap_init (void)
+{
+  static int init = 0;
+
+  if (!init && have_fpu)
+  {
+    fpu_cp_flags = __dpmi_get_coprocessor_status() & 3;
+    signal (SIGNOFP, fpu_trap_handler);
+    init = 1;
+  }
+}
+
+static __inline void fpu_trap_on (int irq)
+{
+  fpu_trap_irq = irq;
+  __dpmi_set_coprocessor_emulation (fpu_cp_flags | 2);
+}
+
+static __inline void fpu_trap_off (void)
+{
+  __dpmi_set_coprocessor_emulation (fpu_cp_flags);
+  fpu_trap_irq = -1;
+}
+#endif
+
 /*
- * Install High-level interrupt handler for IRQ
+ * Install High-level interrupt handler for IRQ. The handler runs
+ * without FPU state saved.
  */
 int request_irq (int i, void (*handler)(int))
+{
+  return request_irq_flags (i, handler, 0);
+}
+
+/*
+ * As above, but with IRQ_FPU in 'flags' the FPU state is saved and
+ * restored around the handler.
+ */
+int request_irq_flags (int i, void (*handler)(int), int flags)
 {
   struct irq_info *irq = irq_cfg + i;
   BYTE   port;
@@ -280,8 +340,13 @@ int request_irq (int i, void (*handler)(int))
   }
 
   irq->new_handler = handler;
+  irq->flags       = flags;
   irq->used        = 1;
 
+#ifdef IRQ_FPU_TRAP
+  fpu_trap_init();
+#endif
+
   irq_eoi_cmd (i);
   enable_irq (i);
   ENABLE();
@@ -298,6 +363,145 @@ failed:
   return (0);
 }
 
+/*
+ * High-level handler of a shared IRQ line. Level-triggered PCI lines
+ * may have several devices asserting at once, so every handler on the
+ * chain is called. irq_umbrella_handler() does the EOI afterwards.
+ */
+static void irq_run_chain (int irq)
+{
+  struct irq_action *act;
+  int    claimed = 0;
+
+  for (act = irq_cfg[irq].action; act; act = act->next)
+  {
+    act->calls++;
+    if ((*act->handler) (irq, act->dev))
+    {
+      act->claims++;
+      act->dev->irq_count++;
+      claimed = 1;
+    }
+  }
+  if (!claimed)
+  {
+    irq_cfg[irq].unclaimed++;
+    TRACE1 (TRC_IRQ, "irq: IRQ%d not claimed\n", irq);
+  }
+}
+
+/*
+ * Add a handler for 'dev' to the chain on IRQ 'i'. The first one
+ * installs the line. Fails if the line has an exclusive handler.
+ */
+int request_shared_irq (int i, int (*handler)(int,struct device*),
+                        struct device *dev, int flags)
+{
+  struct irq_info    *irq;
+  struct irq_action  *act, **tail;
+
+  if (i < 0 || i >= DIM(irq_cfg) || !handler)
+  {
+    PRINTK (("irq: illegal IRQ%d\n", i));
+    return (0);
+  }
+
+  irq = irq_cfg + i;
+  if (irq->used && irq->new_handler != irq_run_chain)
+  {
+    PRINTK (("irq: IRQ%d already in use\n", i));
+    return (0);
+  }
+
+  act = k_calloc (sizeof(*act), 1);
+  if (!act)
+  {
+    PRINTK (("irq: no memory\n"));
+    return (0);
+  }
+  act->handler = handler;
+  act->dev     = dev;
+
+  if (!irq->used)
+  {
+    irq->action    = act;
+    irq->unclaimed = 0;
+    if (!request_irq_flags (i, irq_run_chain, flags))
+    {
+      irq->action = NULL;
+      k_free (act);
+      return (0);
+    }
+    return (1);
+  }
+
+  DISABLE();
+  for (tail = &irq->action; *tail; tail = &(*tail)->next)
+      ;
+  *tail = act;
+  irq->flags |= flags;
+  ENABLE();
+  return (1);
+}
+
+/*
+ * Remove the handler for 'dev' from IRQ 'i'. The last one out
+ * releases the line.
+ */
+int free_shared_irq (int i, struct device *dev)
+{
+  struct irq_info    *irq;
+  struct irq_action  *act, **prev;
+
+  if (i < 0 || i >= DIM(irq_cfg) || irq_cfg[i].new_handler != irq_run_chain)
+  {
+    PRINTK (("irq: IRQ%d not shared\n", i));
+    return (0);
+  }
+
+  irq = irq_cfg + i;
+  for (prev = &irq->action; (act = *prev) != NULL; prev = &act->next)
+      if (act->dev == dev)
+         break;
+
+  if (!act)
+  {
+    PRINTK (("irq: IRQ%d has no handler for %s\n", i, dev->name));
+    return (0);
+  }
+
+  DISABLE();
+  *prev = act->next;
+  ENABLE();
+  k_free (act);
+
+  if (!irq->action)
+     free_irq (i);
+  return (1);
+}
+
+/*
+ * Print the handler chains. A handler with many more calls than
+ * claims is reading the status of a device that wasn't interrupting.
+ */
+void irq_chain_stats (void)
+{
+  struct irq_action *act;
+  int    i;
+
+  for (i = 0; i < DIM(irq_cfg); i++)
+  {
+    if (!irq_cfg[i].used || irq_cfg[i].new_handler != irq_run_chain)
+       continue;
+
+    printk ("IRQ%d: %lu unclaimed\n", i, irq_cfg[i].unclaimed);
+    for (act = irq_cfg[i].action; act; act = act->next)
+        printk ("  %-8s calls %lu, claims %lu, wasted %lu\n",
+                act->dev->name, act->calls, act->claims,
+                act->calls - act->claims);
+  }
+}
+
 /*
  * Hang out at least 5mSec waiting for the IRQ umbrella handler
  * to finish.
@@ -331,6 +535,14 @@ int free_irq (int i)
     irq->new_handler = NULL;
     irq->used        = 0;
 
+    while (irq->action)   /* drop what's left of a shared chain */
+    {
+      struct irq_action *next = irq->action->next;
+
+      k_free (irq->action);
+      irq->action = next;
+    }
+
     _go32_dpmi_set_protected_mode_interrupt_vector (vector,
                                                     &irq->old_handler);
 
@@ -420,23 +632,23 @@ void irq_chain (int i)
 #endif
 }
 
-static __inline void fpu_save (void)
+static __inline void fpu_save (BYTE *fpu_state)
 {
   if (have_fpu)
      __asm__ __volatile__ (
              "fnsave %0\n\t"
              "fwait\n\t"
-             : "=g" (fpu_state)
+             : "=m" (*fpu_state)
            );
 }
 
-static __inline void fpu_restore (void)
+static __inline void fpu_restore (BYTE *fpu_state)
 {
   if (have_fpu)
      __asm__ __volatile__ (
              "frstor %0\n\t"
              "fwait\n\t"
-             : "=g" (fpu_state)
+             : : "m" (*fpu_state)
            );
 }
 
@@ -446,10 +658,12 @@ static __inline void fpu_restore (void)
 void irq_umbrella_handler (int irq)
 {
   volatile int safe = _printk_safe;
+  int    use_fpu;
+#ifdef IRQ_FPU_TRAP
+  int    trapped = fpu_trap_irq;   /* we interrupted a trapped handler */
+#endif
 /*struct pt_regs *regs = (struct pt_regs*) ((DWORD*)&irq+1);  !! to-do */
 
-  fpu_save();
-
   _printk_safe = 0;   /* not safe to use DOS's file I/O now */
   irq_active++;       /* increase interrupt nesting level */
 
@@ -460,10 +674,21 @@ void irq_umbrella_handler (int irq)
     _outportb (0xA0, 0x20);
     irq_active--;
     _printk_safe = safe;
-    fpu_restore();
     return;
   }
 
+  /* Only handlers registered with IRQ_FPU pay for an FNSAVE/FRSTOR.
+   */
+  use_fpu = (irq_cfg[irq].flags & IRQ_FPU);
+#ifdef IRQ_FPU_TRAP
+  if (trapped >= 0)
+     fpu_trap_off();
+  if (!use_fpu && have_fpu)
+     fpu_trap_on (irq);
+#endif
+  if (use_fpu)
+     fpu_save (irq_cfg[irq].fpu_state);
+
 #if 0
   /* If egde-triggered PICs, rearm the 8259 Interrupt Controller
    */
@@ -473,6 +698,11 @@ void irq_umbrella_handler (int irq)
 
   irq_cfg[irq].eoi_done = 0;
 
+  TRACE2 (TRC_IRQ, "irq: IRQ%d, nesting %d\n", irq, irq_active);
+
+  if (irq2dev_map[irq])
+     irq2dev_map[irq]->irq_count++;
+
   /* Call high-level handler
    */
   if (irq_cfg[irq].new_handler)
@@ -483,6 +713,14 @@ void irq_umbrella_handler (int irq)
 
   irq_active--;
   _printk_safe = safe;           /* restore print-safe flag */
-  fpu_restore();
+
+  if (use_fpu)
+     fpu_restore (irq_cfg[irq].fpu_state);
+#ifdef IRQ_FPU_TRAP
+  if (!use_fpu && have_fpu)
+     fpu_trap_off();
+  if (trapped >= 0)
+     fpu_trap_on (trapped);
+#endif
 }
 
@@ -19,7 +19,33 @@ extern WORD irq_our_ds;  /* in intwrap.s */
 extern int  autoirq_setup  (int usec);
 extern int  autoirq_report (int usec);
 
+/*
+ * request_irq_flags() flags. Handlers get no FPU state saved unless
+ * they ask for it with IRQ_FPU. Build irq.c with -DIRQ_FPU_TRAP to
+ * trap FPU use from the other handlers.
+ */
+#define IRQ_FPU  0x01
+
+/*
+ * Handlers on a shared IRQ line. Each returns non-zero if its device
+ * raised the interrupt. The whole chain is called for every interrupt
+ * and the EOI is done once after the last handler. 'calls - claims'
+ * is the number of wasted dispatches.
+ */
+struct irq_action {
+       int               (*handler)(int irq, struct device *dev);
+       struct device      *dev;
+       DWORD               calls;
+       DWORD               claims;
+       struct irq_action  *next;
+     };
+
 extern int  request_irq (int irq, void (*handler)(int));
+extern int  request_irq_flags (int irq, void (*handler)(int), int flags);
+extern int  request_shared_irq (int irq, int (*handler)(int,struct device*),
+                                struct device *dev, int flags);
+extern int  free_shared_irq (int irq, struct device *dev);
+extern void irq_chain_stats (void);
 extern int  free_irq    (int irq)  LOCKED_FUNC;
 extern void enable_irq  (int irq)  LOCKED_FUNC;
 extern void disable_irq (int irq)  LOCKED_FUNC;
@@ -2,20 +2,178 @@
  *  k_malloc.c - Simple "kernel" malloc module.
  *
  *  G. Vanem <giva@bgnet.no> - 1998
+ *
+ *  Small blocks come from size-class free lists carved out of one
+ *  arena that is locked once. Allocating and freeing them needs no
+ *  DPMI call and is safe in interrupt handlers. Larger blocks (and
+ *  everything once the arena is used up) are malloc'ed and locked
+ *  one by one as before.
  */
 
 #include "pmdrvr.h"
 #include "module.h"
 
-#define MARKER 0xDEADBEEF
+#define MARKER      0xDEADBEEF   /* block from malloc()          */
+#define SLAB_MARKER 0xDEADBEAD   /* block in use from the arena  */
+#define SLAB_FREE   0xFEEDBEAD   /* block on a free list         */
+
+#define KSLAB_SIZE  (16*1024)    /* arena is handed out in these */
+#define KARENA_SIZE (256*1024)   /* default arena size           */
 
 DWORD _virtual_base = 0;
 
+/*
+ * Payload sizes of the classes; 1536 fits an Ethernet frame.
+ */
+static const size_t k_class_size [K_NUM_CLASSES] = {
+                    32, 64, 128, 256, 512, 1024, 1536, 2048
+                  };
+
+static struct k_size_class {
+       void  *free;              /* free list                    */
+       DWORD  objects;           /* blocks carved from slabs     */
+       DWORD  in_use;            /* blocks handed out            */
+       DWORD  requested;         /* bytes asked for by in_use    */
+       DWORD  allocs;            /* total allocations            */
+     } k_class [K_NUM_CLASSES] LOCKED_VAR;
+
+static BYTE *arena      LOCKED_VAR = NULL;
+static DWORD arena_size LOCKED_VAR = 0;
+static DWORD arena_used LOCKED_VAR = 0;
+static DWORD big_allocs = 0;    /* blocks from malloc()  */
+static DWORD big_in_use = 0;
+static int   arena_init = 0;
+
+/*
+ * Like DISABLE()/ENABLE(), but leaves the interrupt flag as it was.
+ * We may be called from an interrupt handler.
+ */
+static __inline DWORD k_lock (void)
+{
+  DWORD flags;
+
+  __asm__ __volatile__ ("pushfl; popl %0; cli" : "=g" (flags) : : "memory");
+  return (flags);
+}
+
+static __inline void k_unlock (DWORD flags)
+{
+  __asm__ __volatile__ ("pushl %0; popfl" : : "g" (flags) : "memory", "cc");
+}
+
+/*
+ * Allocate and lock the arena. The size (in kB) may be set with
+ * "set PCAP_ARENA=512"; 0 turns the arena off.
+ */
+static void k_arena_init (void)
+{
+  const char *env = getenv (KARENA_PARAM);
+  DWORD  size = env ? 1024 * atol (env) : KARENA_SIZE;
+
+  arena_init = 1;
+  size &= ~(KSLAB_SIZE-1);
+  if (size == 0)
+     return;
+
+  arena = malloc (size);
+  if (!arena)
+  {
+    printk ("kmalloc: no memory for %lu byte arena\n", size);
+    return;
+  }
+  if (_go32_dpmi_lock_data (arena, size))
+  {
+    printk ("kmalloc: locking arena failed\n");
+    free (arena);
+    arena = NULL;
+    return;
+  }
+  arena_size = size;
+}
+
+/*
+ * Give class 'c' another slab. Called with interrupts off.
+ */
+static int k_grow (int c)
+{
+  int   stride = k_class_size[c] + 8;
+  BYTE *slab;
+  int   i;
+
+  if (arena_used + KSLAB_SIZE > arena_size)
+     return (0);
+
+  slab = arena + arena_used;
+  arena_used += KSLAB_SIZE;
+
+  for (i = 0; i + stride <= KSLAB_SIZE; i += stride)
+  {
+    DWORD *p = (DWORD*) (slab + i);
+
+    p[0] = SLAB_FREE;
+    *(void**)(p+2) = k_class[c].free;
+    k_class[c].free = p + 2;
+    k_class[c].objects++;
+  }
+  return (1);
+}
+
+static void *k_slab_alloc (size_t size)
+{
+  DWORD *p;
+  DWORD  flags;
+  int    c;
+
+  for (c = 0; c < K_NUM_CLASSES; c++)
+      if (size <= k_class_size[c])
+         break;
+  if (c == K_NUM_CLASSES)
+     return (NULL);
+
+  flags = k_lock();
+  if (!k_class[c].free && !k_grow(c))
+  {
+    k_unlock (flags);
+    return (NULL);
+  }
+  p = k_class[c].free;
+  k_class[c].free = *(void**)p;
+  k_class[c].in_use++;
+  k_class[c].requested += size;
+  k_class[c].allocs++;
+  k_unlock (flags);
+
+  p[-2] = SLAB_MARKER;
+  p[-1] = (c << 16) | size;
+  return (void*)p;
+}
+
+static void k_slab_free (DWORD *p)
+{
+  int   c    = p[-1] >> 16;
+  DWORD size = p[-1] & 0xFFFF;
+  DWORD flags;
+
+  flags = k_lock();
+  p[-2] = SLAB_FREE;
+  *(void**)p = k_class[c].free;
+  k_class[c].free = p;
+  k_class[c].in_use--;
+  k_class[c].requested -= size;
+  k_unlock (flags);
+}
+
 void *k_malloc (size_t size)
 {
   DWORD *p;
   void  *buf;
 
+  if (!arena_init)
+     k_arena_init();
+
+  if (arena && (buf = k_slab_alloc(size)) != NULL)
+     return (buf);
+
   size += 3;
   size &= ~3;        /* Round to dword boundary. */
   size += 4+4;       /* add space for marker and size */
@@ -30,6 +188,8 @@ void *k_malloc (size_t size)
 
   if (_go32_dpmi_lock_data (buf, size))
      printk ("kmalloc: locking data failed\n");
+  big_allocs++;
+  big_in_use++;
   return (void*)p;
 }
 
@@ -50,6 +210,11 @@ void k_free (void *ptr)
     DWORD  base = 0;
     DWORD *p = (DWORD*)ptr - 2;
 
+    if (*p == SLAB_MARKER)
+    {
+      k_slab_free (ptr);
+      return;
+    }
     if (*p != MARKER)
     {
       printk ("Panic: freeing bad ptr %p\n", ptr);
@@ -62,6 +227,67 @@ void k_free (void *ptr)
     if (__dpmi_unlock_linear_region (&mem))
        printk ("kmalloc: unlocking data failed\n");
     free (p);
+    big_in_use--;
+  }
+}
+
+/*
+ * Fill in the arena statistics. 'wasted' is what the size classes
+ * round away (internal fragmentation); 'idle' is what sits on the
+ * free lists (carved for one class, unusable by the others).
+ */
+void k_malloc_stats (struct k_arena_stats *st)
+{
+  DWORD flags;
+  int   c;
+
+  memset (st, 0, sizeof(*st));
+
+  flags = k_lock();
+  st->arena_size = arena_size;
+  st->arena_used = arena_used;
+  st->big_allocs = big_allocs;
+  st->big_in_use = big_in_use;
+
+  for (c = 0; c < K_NUM_CLASSES; c++)
+  {
+    DWORD free_objs = k_class[c].objects - k_class[c].in_use;
+
+    st->class_size[c]   = k_class_size[c];
+    st->class_in_use[c] = k_class[c].in_use;
+    st->class_free[c]   = free_objs;
+    st->class_allocs[c] = k_class[c].allocs;
+    st->wasted += k_class[c].in_use * k_class_size[c] - k_class[c].requested;
+    st->idle   += free_objs * k_class_size[c];
   }
+  k_unlock (flags);
+}
+
+/*
+ * Allocate locked memory whose *physical* address is a multiple of
+ * 'align' (a power of 2). For descriptor rings and DMA buffers.
+ * Must be freed with k_free_aligned().
+ */
+void *k_malloc_aligned (size_t size, size_t align)
+{
+  BYTE *buf, *p;
+
+  if (align < sizeof(void*))
+      align = sizeof(void*);
+
+  buf = k_malloc (size + align + sizeof(void*));
+  if (!buf)
+     return (NULL);
+
+  p  = buf + sizeof(void*);
+  p += (align - (VIRT_TO_PHYS(p) & (align-1))) & (align-1);
+  ((void**)p)[-1] = buf;   /* remember what k_malloc() gave us */
+  return (void*)p;
+}
+
+void k_free_aligned (void *ptr)
+{
+  if (ptr)
+     k_free (((void**)ptr)[-1]);
 }
 
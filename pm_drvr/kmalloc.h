@@ -14,4 +14,28 @@
   #define k_free   free
 #endif
 
+extern void *k_malloc_aligned (size_t size, size_t align);
+extern void  k_free_aligned   (void *ptr);
+
+/*
+ * Arena of size-class blocks behind k_malloc(); see kmalloc.c.
+ */
+#define K_NUM_CLASSES  8
+#define KARENA_PARAM   "PCAP_ARENA"  /* arena size in kB */
+
+struct k_arena_stats {
+       DWORD arena_size;             /* bytes locked for the arena   */
+       DWORD arena_used;             /* bytes carved into slabs      */
+       DWORD wasted;                 /* in-use bytes lost to rounding */
+       DWORD idle;                   /* bytes on the free lists      */
+       DWORD big_allocs;             /* blocks locked one by one     */
+       DWORD big_in_use;
+       DWORD class_size   [K_NUM_CLASSES];
+       DWORD class_in_use [K_NUM_CLASSES];
+       DWORD class_free   [K_NUM_CLASSES];
+       DWORD class_allocs [K_NUM_CLASSES];
+     };
+
+extern void k_malloc_stats (struct k_arena_stats *st);
+
 #endif
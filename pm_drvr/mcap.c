@@ -0,0 +1,182 @@
+/*
+ *  mcap.c - Merged capture from several devices.
+ *
+ *  See mcap.h for how the per-device rings are merged.
+ */
+
+#include "pmdrvr.h"
+#include "module.h"
+#include "mcap.h"
+
+static struct mcap_ring rings [MCAP_MAX_DEVS] LOCKED_VAR;
+static int              num_rings = 0;
+
+/*
+ * Queue a frame of 'len' bytes on 'ring' and return where the driver
+ * should put it. Called from the driver's ISR (or poll routine).
+ */
+static BYTE *mcap_enqueue (struct mcap_ring *ring, int len)
+{
+  struct mcap_frame *frame;
+
+  if (len > MCAP_FRAME_SIZE || ring->in - ring->out >= MCAP_RING_SIZE)
+  {
+    ring->dropped++;
+    return (NULL);
+  }
+  frame = ring->frame + (ring->in & (MCAP_RING_SIZE-1));
+  frame->stamp = uclock();
+  frame->len   = len;
+  ring->in++;
+  ring->frames++;
+  return (frame->data);
+}
+
+/*
+ * dev->get_rx_buf() has no device argument, so each ring gets a
+ * routine of its own.
+ */
+static BYTE *get_rx_buf_0 (int len) LOCKED_FUNC;
+static BYTE *get_rx_buf_1 (int len) LOCKED_FUNC;
+static BYTE *get_rx_buf_2 (int len) LOCKED_FUNC;
+static BYTE *get_rx_buf_3 (int len) LOCKED_FUNC;
+
+static BYTE *get_rx_buf_0 (int len) { return mcap_enqueue (rings+0, len); }
+static BYTE *get_rx_buf_1 (int len) { return mcap_enqueue (rings+1, len); }
+static BYTE *get_rx_buf_2 (int len) { return mcap_enqueue (rings+2, len); }
+static BYTE *get_rx_buf_3 (int len) { return mcap_enqueue (rings+3, len); }
+
+static BYTE *(*get_rx_bufs [MCAP_MAX_DEVS]) (int) = {
+               get_rx_buf_0, get_rx_buf_1,
+               get_rx_buf_2, get_rx_buf_3
+             };
+
+static void mcap_release (int num, int opened)
+{
+  int i;
+
+  for (i = 0; i < num; i++)
+  {
+    struct mcap_ring *ring = rings + i;
+    struct device    *dev  = ring->dev;
+
+    if (i < opened)
+       (*dev->close) (dev);
+    dev->get_rx_buf   = ring->old_get_rx_buf;
+    dev->swap_rx_buf  = ring->old_swap_rx_buf;
+    dev->rx_slot_size = ring->old_slot_size;
+    dev->poll_ok      = ring->old_poll_ok;
+    dev->flags        = ring->old_flags;
+    if (ring->frame)
+       k_free (ring->frame);
+    ring->frame = NULL;
+  }
+}
+
+/*
+ * Open 'num' devices for a merged capture. Frames are read with
+ * mcap_read(); 'index' there is the position of the device in 'devs'.
+ * Returns 0 or a negative errno.
+ */
+int mcap_open (struct device **devs, int num, int promisc)
+{
+  int i;
+
+  if (num_rings > 0)
+     return (-EBUSY);
+
+  if (num < 1 || num > MCAP_MAX_DEVS)
+     return (-EINVAL);
+
+  uclock();  /* the first call sets up the PIT; do it here and not in an ISR */
+
+  for (i = 0; i < num; i++)
+  {
+    struct mcap_ring *ring = rings + i;
+    struct device    *dev  = devs[i];
+
+    memset (ring, 0, sizeof(*ring));
+    ring->dev             = dev;
+    ring->old_flags       = dev->flags;
+    ring->old_get_rx_buf  = dev->get_rx_buf;
+    ring->old_swap_rx_buf = dev->swap_rx_buf;
+    ring->old_slot_size   = dev->rx_slot_size;
+    ring->old_poll_ok     = dev->poll_ok;
+    ring->frame           = k_calloc (MCAP_RING_SIZE, sizeof(struct mcap_frame));
+    if (!ring->frame)
+    {
+      mcap_release (i+1, i);
+      return (-ENOMEM);
+    }
+
+    dev->get_rx_buf   = get_rx_bufs[i];
+    dev->swap_rx_buf  = NULL;
+    dev->rx_slot_size = 0;
+    dev->poll_ok      = 1;     /* mcap_read() calls netif_poll() */
+    if (promisc)
+       dev->flags |= IFF_PROMISC;
+
+    if (!(*dev->open)(dev))
+    {
+      printk ("mcap: failed to open %s\n", dev->name);
+      mcap_release (i+1, i);
+      return (-EIO);
+    }
+  }
+  num_rings = num;
+  return (0);
+}
+
+/*
+ * Copy the oldest queued frame (of all devices) to 'buf'. Returns its
+ * length, or 0 if no frame is queued. The frame is truncated to 'max'.
+ */
+int mcap_read (BYTE *buf, int max, int *index, uclock_t *stamp)
+{
+  struct mcap_frame *frame, *oldest = NULL;
+  int    i, len, ring = 0;
+
+  for (i = 0; i < num_rings; i++)
+      netif_poll (rings[i].dev, MCAP_POLL_BUDGET);
+
+  for (i = 0; i < num_rings; i++)
+  {
+    if (rings[i].out == rings[i].in)
+       continue;
+
+    frame = rings[i].frame + (rings[i].out & (MCAP_RING_SIZE-1));
+    if (!oldest || frame->stamp < oldest->stamp)
+    {
+      oldest = frame;
+      ring   = i;
+    }
+  }
+
+  if (!oldest)
+     return (0);
+
+  len = oldest->len < max ? oldest->len : max;
+  memcpy (buf, oldest->data, len);
+  if (index)
+     *index = ring;
+  if (stamp)
+     *stamp = oldest->stamp;
+  rings[ring].out++;
+  return (len);
+}
+
+void mcap_close (void)
+{
+  mcap_release (num_rings, num_rings);
+  num_rings = 0;
+}
+
+/*
+ * Return the ring of device 'index' (for its counters), or NULL.
+ */
+const struct mcap_ring *mcap_stats (int index)
+{
+  if (index < 0 || index >= num_rings)
+     return (NULL);
+  return (rings + index);
+}
@@ -0,0 +1,54 @@
+#ifndef __MCAP_H
+#define __MCAP_H
+
+/*
+ * Merged capture from several devices, e.g. both sides of a passive
+ * tap. Each device gets its own receive ring, filled by the driver
+ * through dev->get_rx_buf(). The frame is time-stamped with uclock()
+ * as it is queued. mcap_read() then merges the rings by time-stamp.
+ * It returns the oldest queued frame, together with the index of
+ * its device in the array given to mcap_open().
+ *
+ * A frame queued later always has a later time-stamp than the frames
+ * already queued. So the oldest ring head is always the next frame to
+ * return, and the output stays ordered.
+ *
+ * Only one merged capture may be open at a time. Merged devices copy
+ * each frame into the ring; the zero-copy slots (swap_rx_buf) are not
+ * used.
+ */
+#define MCAP_MAX_DEVS    4     /* devices in a merged capture      */
+#define MCAP_RING_SIZE   64    /* frames queued per device (2^n)   */
+#define MCAP_FRAME_SIZE  1536  /* largest frame kept               */
+#define MCAP_POLL_BUDGET 16    /* netif_poll() budget per read     */
+
+struct mcap_frame {
+       uclock_t  stamp;        /* arrival time (uclock() units)    */
+       int       len;
+       BYTE      data [MCAP_FRAME_SIZE];
+     };
+
+struct mcap_ring {
+       struct device     *dev;
+       struct mcap_frame *frame;     /* MCAP_RING_SIZE frames      */
+       volatile DWORD     in;        /* next frame to fill (ISR)   */
+       volatile DWORD     out;       /* next frame to read         */
+       DWORD              frames;    /* frames queued              */
+       DWORD              dropped;   /* ring full or frame too big */
+       WORD               old_flags; /* dev->flags before open     */
+
+       /* The receive hooks and dev->poll_ok before open, restored
+        * on close.
+        */
+       BYTE *(*old_get_rx_buf)  (int len);
+       BYTE *(*old_swap_rx_buf) (BYTE *slot, int ofs, int len);
+       int     old_slot_size;
+       int     old_poll_ok;
+     };
+
+extern int  mcap_open  (struct device **devs, int num, int promisc);
+extern int  mcap_read  (BYTE *buf, int max, int *index, uclock_t *stamp);
+extern void mcap_close (void);
+extern const struct mcap_ring *mcap_stats (int index);
+
+#endif
@@ -0,0 +1,261 @@
+/*
+ *  modreg.c - Load only the driver modules for the hardware present.
+ *             See modreg.h.
+ */
+
+#include <sys/dxe.h>
+#ifdef USE_DXE3
+#include <dlfcn.h>
+#endif
+
+#include "pmdrvr.h"
+
+#undef _MODULE
+#include "module.h"
+#include "bios32.h"
+#include "pci.h"
+#include "modreg.h"
+
+#define PRINTK(x) do {             \
+                    if (pci_debug) \
+                       printk x ;  \
+                  } while (0)
+
+/* As pci_tbl[] in rtl8139.c
+ */
+static const struct wlm_pci_id rtl8139_ids[] = {
+             { PCI_VENDOR_ID_REALTEK, 0x8129, 0xFFFF },
+             { PCI_VENDOR_ID_REALTEK, 0x8139, 0xFFFF },
+             { PCI_VENDOR_ID_REALTEK, 0x8138, 0xFFFF },
+             { 0x1113,                0x1211, 0xFFFF },  /* SMC1211TX, Accton */
+             { 0x1039,                0x0900, 0xFFFF },  /* SiS 900 */
+             { 0x1039,                0x7016, 0xFFFF },  /* SiS 7016 */
+             { 0, }
+           };
+
+static int el3_check (void);
+
+/* Only drivers with a wlm_main() and a .wlm rule in makefile.dj are
+ * listed.
+ */
+static struct wlm_module modules[] = {
+  { "rtl8139",  rtl8139_ids,  NULL      },
+  { "3c509",    NULL,         el3_check }
+};
+
+/*
+ * A 3c509 answers the ID sequence on a free ID port with 3Com's
+ * code in EEPROM word 7. Same as the start of el3_probe(), which
+ * sends the sequence again.
+ */
+static int el3_check (void)
+{
+  int  id_port, i, bit;
+  WORD lrs_state = 0xFF, word = 0;
+
+  for (id_port = 0x100; id_port < 0x200; id_port += 0x10)
+  {
+    outb (0x00, id_port);
+    outb (0xff, id_port);
+    if (inb (id_port) & 1)
+       break;
+  }
+  if (id_port >= 0x200)
+     return (0);
+
+  outb (0x00, id_port);
+  outb (0x00, id_port);
+  for (i = 0; i < 255; i++)
+  {
+    outb (lrs_state, id_port);
+    lrs_state <<= 1;
+    lrs_state = lrs_state & 0x100 ? lrs_state ^ 0xcf : lrs_state;
+  }
+  outb (0xD0, id_port);        /* clear the tags */
+
+  outb (0x80 + 7, id_port);    /* EEPROM read, word 7 */
+  delay (1);
+  for (bit = 15; bit >= 0; bit--)
+      word = (word << 1) + (inb(id_port) & 1);
+  return (word == 0x6D50);
+}
+
+static struct wlm_module *find_module (const char *name)
+{
+  int i;
+
+  for (i = 0; i < DIM(modules); i++)
+      if (!stricmp (modules[i].name, name))
+         return (modules + i);
+  return (NULL);
+}
+
+/*
+ * Which module handles PCI device 'vendor/device'. NULL if none.
+ */
+const struct wlm_module *wlm_find_pci (WORD vendor, WORD device)
+{
+  const struct wlm_pci_id *id;
+  int   i;
+
+  for (i = 0; i < DIM(modules); i++)
+  {
+    if (!modules[i].pci_ids)
+       continue;
+    for (id = modules[i].pci_ids; id->vendor; id++)
+        if (id->vendor == vendor && (device & id->mask) == id->device)
+           return (modules + i);
+  }
+  return (NULL);
+}
+
+#ifndef USE_DXE3
+static struct libc_import exports;
+#endif
+
+/*
+ * Load module 'name' (without ".wlm") and call its wlm_main(). Returns
+ * the module's device, or NULL. A module already loaded is not loaded
+ * again.
+ */
+struct device *wlm_load (const char *name, int debug_level)
+{
+  struct wlm_module *mod = find_module (name);
+  const char *dir = getenv (WLM_DIR_PARAM);
+  char   file [WLM_MAX_NAME];
+  struct device *dev;
+  dll_entry entry;
+#ifdef USE_DXE3
+  void  *handle;
+#endif
+
+  if (mod && mod->entry)
+     return (mod->dev);
+
+  if (dir && *dir)
+       _snprintk (file, sizeof(file), "%s/%s.wlm", dir, name);
+  else _snprintk (file, sizeof(file), "%s.wlm", name);
+
+#ifdef USE_DXE3
+  handle = dlopen (file, RTLD_GLOBAL);
+  if (!handle)
+  {
+    printk ("%s: module not loaded; %s\n", file, dlerror());
+    return (NULL);
+  }
+  entry = (dll_entry) dlsym (handle, "_wlm_main");
+  if (!entry)
+  {
+    printk ("%s: no wlm_main()\n", file);
+    dlclose (handle);
+    return (NULL);
+  }
+#else
+  entry = _dxe_load (file);
+  if (!entry)
+  {
+    printk ("%s: module not loaded\n", file);
+    return (NULL);
+  }
+
+  if (!exports.printf)
+  {
+    struct libc_import li = {
+           printf, sprintf, fprintf, fwrite, fopen, fclose,
+           malloc, free,
+           memset, memcpy, memchr,
+           strchr, strlen, strcmp, strncmp, strtoul,
+           _go32_dpmi_get_protected_mode_interrupt_vector,
+           _go32_dpmi_set_protected_mode_interrupt_vector,
+           _go32_dpmi_lock_data,
+           __dpmi_unlock_linear_region,
+           __dpmi_allocate_dos_memory,
+           __dpmi_set_segment_limit,
+           __dpmi_set_descriptor_access_rights,
+           __dpmi_get_descriptor_access_rights,
+           __dpmi_allocate_ldt_descriptors,
+           __dpmi_set_segment_base_address,
+           __dpmi_get_segment_base_address,
+           __dpmi_free_ldt_descriptor,
+           uclock, usleep, delay, sound,
+           dosmemget, longjmp, setjmp, signal,
+           &__djgpp_exception_state_ptr,
+           &__djgpp_ds_alias,
+           &EISA_bus,
+           NULL
+         };
+    exports = li;
+  }
+#endif
+
+  PRINTK (("%s: loaded, entry at %08Xh\n", file, (unsigned)entry));
+
+#ifdef USE_DXE3
+  dev = (*entry) (NULL, debug_level);   /* the DXE3 loader links libc */
+#else
+  dev = (*entry) (&exports, debug_level);
+#endif
+
+  if (mod)
+  {
+    mod->entry = entry;
+    mod->dev   = dev;
+  }
+  return (dev);
+}
+
+/*
+ * Load the modules for the cards pci_init() found, for ISA cards that
+ * pass their module's check and those named in "PCAP_WLM". Up to
+ * 'max' new devices are stored in 'devs'. Returns their number.
+ */
+int wlm_load_needed (int debug_level, struct device **devs, int max)
+{
+  const struct pci_dev *pdev;
+  const char *env = getenv (WLM_LOAD_PARAM);
+  int   i, num = 0;
+
+  for (i = 0; i < DIM(modules); i++)
+      modules[i].needed = (modules[i].isa_check && (*modules[i].isa_check)());
+
+  for (pdev = pci_devices; pdev; pdev = pdev->next)
+  {
+    struct wlm_module *mod = (struct wlm_module*) wlm_find_pci (pdev->vendor, pdev->device);
+
+    if (mod)
+       mod->needed = 1;
+  }
+
+  while (env && *env)
+  {
+    char   name [20];
+    size_t len = strcspn (env, ",; ");
+    struct wlm_module *mod;
+
+    if (len > 0 && len < sizeof(name))
+    {
+      memcpy (name, env, len);
+      name[len] = '\0';
+      mod = find_module (name);
+      if (mod)
+           mod->needed = 1;
+      else printk ("%s: unknown module `%s'\n", WLM_LOAD_PARAM, name);
+    }
+    env += len;
+    if (*env)
+       env++;
+  }
+
+  for (i = 0; i < DIM(modules) && num < max; i++)
+  {
+    struct device *dev;
+
+    if (!modules[i].needed || modules[i].entry)
+       continue;
+
+    dev = wlm_load (modules[i].name, debug_level);
+    if (dev)
+       devs [num++] = dev;
+  }
+  return (num);
+}
@@ -0,0 +1,48 @@
+#ifndef __MODREG_H
+#define __MODREG_H
+
+/*
+ * Registry of driver modules (.wlm files). Maps the PCI IDs a module
+ * handles, or a cheap ISA presence check, to the module file. With
+ * USE_32BIT_MODULES=1, wlm_load_needed() loads only the modules for
+ * cards found by pci_init() and the ISA checks. Each module is loaded
+ * once; its device is returned for the caller to probe.
+ *
+ * So far rtl8139.wlm (by PCI ID) and 3c509.wlm (by ISA check) are
+ * the modules with a wlm_main(). Other drivers must be linked in
+ * statically. The open path calls pci_init() and then
+ * wlm_load_needed(), and probes the devices returned; dxe_run.c
+ * does just that.
+ *
+ * With USE_DXE3 the modules are opened with dlopen(). The symbols they
+ * leave to the program (pcibios_*(), init_etherdev(), libc) must then
+ * be registered with dlregsym() first; dxe3res makes the table.
+ *
+ * Modules are looked for in "PCAP_WLMDIR" (or the current directory).
+ * "PCAP_WLM" lists modules to load without a check, e.g.
+ * "set PCAP_WLM=3c509".
+ */
+#define WLM_DIR_PARAM   "PCAP_WLMDIR"
+#define WLM_LOAD_PARAM  "PCAP_WLM"
+#define WLM_MAX_NAME    80
+
+struct wlm_pci_id {
+       WORD  vendor;
+       WORD  device;
+       WORD  mask;             /* device ID bits to compare */
+     };
+
+struct wlm_module {
+       const char              *name;     /* "3c509" for "3c509.wlm" */
+       const struct wlm_pci_id *pci_ids;  /* ends with vendor 0; NULL if ISA */
+       int                    (*isa_check) (void); /* non-zero if a card may be there */
+       int                      needed;
+       dll_entry                entry;    /* set once loaded */
+       struct device           *dev;      /* returned by wlm_main() */
+     };
+
+extern struct device           *wlm_load        (const char *name, int debug_level);
+extern int                      wlm_load_needed (int debug_level, struct device **devs, int max);
+extern const struct wlm_module *wlm_find_pci    (WORD vendor, WORD device);
+
+#endif
@@ -203,6 +203,102 @@ int register_netdev (struct device *dev)
   return (0);
 }
 
+/*
+ * Called from the capture loop. Let a device in polled mode receive
+ * at most 'budget' frames. Returns number of frames received.
+ */
+int netif_poll (struct device *dev, int budget)
+{
+  int rc;
+
+  if (!dev->poll || !dev->polling)
+     return (0);
+
+  rc = (*dev->poll) (dev, budget);
+  dev->poll_count++;
+  dev->poll_frames += rc;
+  return (rc);
+}
+
+/*
+ * Coalescing levels for netif_coalesce_tune(). A level is used from
+ * 'pps' Rx frames/sec and up. Light traffic gets an interrupt per
+ * frame; heavy traffic gets fewer, longer interrupts.
+ */
+#define COAL_TUNE_MSEC  100   /* min. time between adjustments */
+
+static const struct coal_level {
+       DWORD pps;
+       int   frames;
+       int   usecs;
+     } coal_levels[] = {
+       {     0,  1,   0 },
+       {  5000,  4, 100 },
+       { 20000,  8, 250 },
+       { 60000, 16, 500 }
+     };
+
+static int set_coalesce (struct device *dev, int frames, int usecs)
+{
+  int rc = (*dev->set_coalesce) (dev, frames, usecs);
+
+  if (rc == 0)
+  {
+    dev->coal_frames = frames;
+    dev->coal_usecs  = usecs;
+  }
+  return (rc);
+}
+
+/*
+ * Set fixed coalescing values; stops the adaptive control.
+ */
+int netif_set_coalesce (struct device *dev, int frames, int usecs)
+{
+  if (!dev->set_coalesce)
+     return (-EINVAL);
+
+  dev->coal_adaptive = 0;
+  return set_coalesce (dev, frames, usecs);
+}
+
+/*
+ * Adaptive control. Called periodically by the driver with its count
+ * of received frames. Going down a level needs the rate to fall a
+ * quarter below the current level to avoid flapping.
+ */
+void netif_coalesce_tune (struct device *dev, DWORD rx_frames)
+{
+  DWORD now = jiffies;
+  DWORD elapsed = now - dev->coal_time_last;
+  DWORD pps;
+  int   i, cur;
+
+  if (!dev->coal_adaptive || !dev->set_coalesce || elapsed < COAL_TUNE_MSEC)
+     return;
+
+  pps = (rx_frames - dev->coal_rx_last) / elapsed * 1000 +
+        (rx_frames - dev->coal_rx_last) % elapsed * 1000 / elapsed;
+  dev->coal_rx_last   = rx_frames;
+  dev->coal_time_last = now;
+
+  for (cur = DIM(coal_levels)-1; cur > 0; cur--)
+      if (coal_levels[cur].frames == dev->coal_frames &&
+          coal_levels[cur].usecs  == dev->coal_usecs)
+         break;
+
+  for (i = DIM(coal_levels)-1; i > 0; i--)
+      if (pps >= coal_levels[i].pps)
+         break;
+
+  if (i < cur && pps >= coal_levels[cur].pps * 3 / 4)
+     i = cur;
+
+  if (coal_levels[i].frames != dev->coal_frames ||
+      coal_levels[i].usecs  != dev->coal_usecs)
+     set_coalesce (dev, coal_levels[i].frames, coal_levels[i].usecs);
+}
+
 
 #ifdef NOT_USED /* only for dynamically loaded modules */
 
@@ -0,0 +1,253 @@
+/*
+ *  pacer.c - Transmit frames at planned departure times.
+ *
+ *  See pacer.h for how departures are planned.
+ */
+
+#include "pmdrvr.h"
+#include "module.h"
+#include "pacer.h"
+
+static int   use_tsc  = -1;      /* -1 = not checked yet */
+static QWORD clock_hz = 0;
+static int   timer_ok = 0;
+
+static struct timer_list pace_timer LOCKED_VAR;
+static volatile int      pace_woken LOCKED_VAR = 0;
+
+static void pace_wakeup (DWORD data) LOCKED_FUNC;
+
+/*
+ * Does the CPU have a time-stamp counter? CPUID exists if the ID
+ * flag (bit 21) in EFLAGS can be changed.
+ */
+static int has_tsc (void)
+{
+  DWORD a, b, c, d;
+
+  __asm__ __volatile__ ("pushfl; popl %0; movl %0, %1;"
+                        "xorl $0x200000, %0; pushl %0; popfl;"
+                        "pushfl; popl %0; pushl %1; popfl"
+                        : "=&r" (a), "=&r" (b));
+  if (!((a ^ b) & 0x200000))
+     return (0);
+
+  __asm__ __volatile__ ("cpuid" : "=a" (a), "=b" (b), "=c" (c), "=d" (d)
+                                : "a" (0));
+  if (a < 1)
+     return (0);
+
+  __asm__ __volatile__ ("cpuid" : "=a" (a), "=b" (b), "=c" (c), "=d" (d)
+                                : "a" (1));
+  return ((d & 0x10) != 0);
+}
+
+/*
+ * The clock departures are measured by.
+ */
+QWORD pace_clock (void)
+{
+  if (use_tsc > 0)
+  {
+    QWORD tsc;
+
+    __asm__ __volatile__ ("rdtsc" : "=A" (tsc));
+    return (tsc);
+  }
+  return ((QWORD) uclock());
+}
+
+/*
+ * Count cycles for 1/20 second of uclock().
+ */
+static void pace_calibrate (void)
+{
+  uclock_t u0, u1, u2;
+  QWORD    c0, c1;
+
+  use_tsc = has_tsc();
+  if (!use_tsc)
+  {
+    clock_hz = UCLOCKS_PER_SEC;
+    return;
+  }
+
+  u0 = uclock();
+  while ((u1 = uclock()) == u0)   /* start on a uclock() edge */
+        ;
+  c0 = pace_clock();
+  while ((u2 = uclock()) - u1 < UCLOCKS_PER_SEC / 20)
+        ;
+  c1 = pace_clock();
+  clock_hz = (c1 - c0) * UCLOCKS_PER_SEC / (u2 - u1);
+}
+
+static void pace_wakeup (DWORD data)
+{
+  pace_woken = 1;
+  ARGSUSED (data);
+}
+
+/*
+ * Wait until pace_clock() reaches 'when'. Sleep on a timeout until
+ * two timer ticks are left, then spin.
+ */
+static void pace_wait (QWORD when)
+{
+  QWORD now   = pace_clock();
+  QWORD guard = timer_ok ? 2 * clock_hz / timer_rate() : 0;
+
+  if (timer_ok && when > now + guard)
+  {
+    pace_timer.expires  = RUN_AT ((when - now - guard) * HZ / clock_hz);
+    pace_timer.function = pace_wakeup;
+    pace_timer.data     = 0;
+    pace_woken = 0;
+    if (add_timer (&pace_timer))
+       while (!pace_woken)
+             __dpmi_yield();
+  }
+  while (pace_clock() < when)
+        ;
+}
+
+/*
+ * Set up 'p' to transmit on 'dev'. The device must be open.
+ * Returns 0 if it can't transmit.
+ */
+int pace_init (struct pacer *p, struct device *dev)
+{
+  if (!dev || !dev->xmit)
+     return (0);
+
+  if (use_tsc < 0)
+  {
+    pace_calibrate();
+    timer_ok = init_timer (&pace_timer);
+  }
+  memset (p, 0, sizeof(*p));
+  p->dev = dev;
+  p->hz  = clock_hz;
+  return (1);
+}
+
+/*
+ * Send frames without a time-stamp at 'pps' frames or 'bps' bits per
+ * second, whichever is slower. Zero means no limit.
+ */
+void pace_rate (struct pacer *p, DWORD pps, DWORD bps)
+{
+  p->pps = pps;
+  p->bps = bps;
+}
+
+/*
+ * Time the last frame takes at the target rate.
+ */
+static QWORD pace_interval (const struct pacer *p)
+{
+  QWORD ival = 0, bits;
+
+  if (p->pps)
+     ival = p->hz / p->pps;
+  if (p->bps)
+  {
+    bits = (QWORD)p->last_len * 8 * p->hz / p->bps;
+    if (bits > ival)
+       ival = bits;
+  }
+  return (ival);
+}
+
+/*
+ * Transmit 'buf' at its departure time. 'ts' is the frame's time-stamp
+ * (e.g. from a savefile), or NULL to use the rate set by pace_rate().
+ * Returns 0 if the transmitter stayed busy.
+ */
+int pace_xmit (struct pacer *p, const void *buf, int len,
+               const struct timeval *ts)
+{
+  struct pace_stats *st = &p->stats;
+  QWORD  sent_at, late, usec, give_up;
+  int    rc, bin;
+
+  if (!p->started)
+  {
+    p->first = p->next = pace_clock();
+    if (ts)
+       p->first_ts = *ts;
+    p->started = 1;
+  }
+  else if (ts)
+  {
+    long long ofs = (long long)(ts->tv_sec - p->first_ts.tv_sec) * 1000000 +
+                    (ts->tv_usec - p->first_ts.tv_usec);
+
+    if (ofs < 0)                 /* time-stamps went backwards */
+       ofs = 0;
+
+    /* Whole seconds first; ofs * hz overflows after ~5 hours at 1 GHz.
+     */
+    p->next = p->first + (QWORD)(ofs / 1000000) * p->hz +
+                         (QWORD)(ofs % 1000000) * p->hz / 1000000;
+  }
+  else
+    p->next += pace_interval (p);
+
+  p->last_len = len;
+  pace_wait (p->next);
+
+  give_up = pace_clock() + PACE_RETRY_USEC * p->hz / 1000000;
+  do
+  {
+    sent_at = pace_clock();
+    rc = (*p->dev->xmit) (p->dev, buf, len);
+  }
+  while (!rc && sent_at < give_up);
+
+  if (!rc)
+  {
+    st->failed++;
+    return (0);
+  }
+
+  late = sent_at > p->next ? sent_at - p->next : 0;
+  usec = late * 1000000 / p->hz;
+  for (bin = 0; usec && bin < PACE_HIST_BINS-1; bin++)
+      usec >>= 1;
+
+  st->hist[bin]++;
+  st->late_sum += late;
+  if (late > st->late_max)
+     st->late_max = late;
+  st->sent++;
+  return (1);
+}
+
+/*
+ * Print the lateness histogram.
+ */
+void pace_report (const struct pacer *p)
+{
+  const struct pace_stats *st = &p->stats;
+  int   i;
+
+  printk ("pace: %lu frames sent, %lu failed, clock %lu kHz%s\n",
+          st->sent, st->failed, (DWORD)(p->hz / 1000),
+          use_tsc > 0 ? " (TSC)" : "");
+  if (!st->sent)
+     return;
+
+  printk ("pace: late by %lu us mean, %lu us max\n",
+          (DWORD)(st->late_sum * 1000000 / p->hz / st->sent),
+          (DWORD)(st->late_max * 1000000 / p->hz));
+
+  for (i = 0; i < PACE_HIST_BINS; i++)
+  {
+    if (!st->hist[i])
+       continue;
+    if (i < PACE_HIST_BINS-1)
+         printk ("pace:   < %5lu us: %lu\n", 1UL << i, st->hist[i]);
+    else printk ("pace:  >= %5lu us: %lu\n", 1UL << (i-1), st->hist[i]);
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef __PACER_H
+#define __PACER_H
+
+/*
+ * Paced transmit, e.g. to replay a savefile with its own inter-frame
+ * gaps or to send at an exact packet or bit rate.
+ *
+ * Every frame gets an absolute departure time. With a time-stamp it
+ * is the first frame's departure plus the time-stamp's offset from
+ * the first time-stamp; without one it is the previous departure plus
+ * the frame's length at the target rate. So errors never accumulate.
+ *
+ * Time is kept by the Pentium cycle counter, calibrated against
+ * uclock() (or uclock() itself on CPUs without one). A wait longer
+ * than a few timer ticks sleeps on a timer.c timeout first, then
+ * spins for the rest. Use "timer_irq = 8" (the RTC at 64 Hz) before
+ * pace_init() for short coarse waits; IRQ 0 ticks only 18 times a
+ * second.
+ *
+ * The lateness of each frame (actual minus planned departure) goes
+ * into a log2 histogram that pace_report() prints.
+ */
+#define PACE_HIST_BINS   16     /* < 1us, < 2us, .. < 16ms, more  */
+#define PACE_RETRY_USEC  1000   /* keep trying a busy transmitter */
+
+struct pace_stats {
+       DWORD  sent;
+       DWORD  failed;             /* xmit() busy for PACE_RETRY_USEC */
+       DWORD  hist [PACE_HIST_BINS];
+       QWORD  late_sum;           /* cycles, for the mean           */
+       QWORD  late_max;
+     };
+
+struct pacer {
+       struct device    *dev;
+       QWORD             hz;        /* clock counts per second       */
+       DWORD             pps;       /* target rate, 0 = none         */
+       DWORD             bps;
+       int               started;
+       QWORD             first;     /* departure of the first frame  */
+       QWORD             next;      /* departure of the last frame   */
+       int               last_len;  /* and its length                */
+       struct timeval    first_ts;  /* time-stamp of the first frame */
+       struct pace_stats stats;
+     };
+
+extern int   pace_init   (struct pacer *p, struct device *dev);
+extern void  pace_rate   (struct pacer *p, DWORD pps, DWORD bps);
+extern int   pace_xmit   (struct pacer *p, const void *buf, int len,
+                          const struct timeval *ts);
+extern void  pace_report (const struct pacer *p);
+extern QWORD pace_clock  (void);
+
+#endif
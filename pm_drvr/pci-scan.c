@@ -239,6 +239,10 @@ int pci_find_capability (struct pci_dev *pdev, int findtype)
   BYTE pci_cap_idx;
   int  cap_idx;
 
+  cap_idx = pci_snap_find_cap (pdev->bus->number, pdev->devfn, findtype);
+  if (cap_idx >= 0)
+     return (cap_idx);
+
   pci_read_config_word (pdev, PCI_STATUS, &pci_status);
   if (!(pci_status & PCI_STATUS_CAP_LIST))
      return (0);
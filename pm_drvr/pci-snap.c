@@ -0,0 +1,691 @@
+/*
+ *  pci-snap.c - Snapshot of PCI configuration headers.
+ *
+ *  pci_scan_bus() records the 64 byte header and the capability list
+ *  of every function it finds. After that, the config-space readers
+ *  in bios32.c answer reads of the header from the snapshot, and the
+ *  pcibios_find_xx() and pci_find_xx() functions use sorted indexes
+ *  instead of walking the bus or the device list. Reads of an empty
+ *  slot on a scanned bus return all ones without touching the bus.
+ *
+ *  Registers the hardware changes on its own (command/status, the
+ *  secondary status of bridges) are never cached. A write to a header
+ *  register drops it from the snapshot; the next read fetches it
+ *  again. A write above the header (e.g. a power-state change) drops
+ *  the whole header of that function.
+ *
+ *  If "PCAP_PCISNAP" names a file, the snapshot is saved there. At the
+ *  next start it is loaded and checked against the hardware: IDs,
+ *  class, header type and BARs of each function. If all match, the
+ *  scan skips probing the empty slots. Otherwise the file is ignored
+ *  and rewritten after a full scan. A card added in a slot that was
+ *  empty is not seen until the file is deleted.
+ */
+
+#include "pmdrvr.h"
+#include "module.h"
+#include "bios32.h"
+#include "pci.h"
+
+#define PRINTK(x) do {             \
+                    if (pci_debug) \
+                       printk x ;  \
+                  } while (0)
+
+#define PCI_SNAP_MAGIC     0x504E5350   /* "PSNP" */
+#define PCI_SNAP_REC_WORDS (1 + PCI_SNAP_HDR_WORDS + PCI_SNAP_CAPS/2)
+
+#define CAP_LIST_STATUS    0x10   /* status: capability list present */
+#define CAP_LIST_PTR       0x34   /* first capability, header type 0/1 */
+#define CAP_LIST_PTR_CB    0x14   /* first capability, CardBus bridge  */
+
+static struct pci_snap *snap_tab  [PCI_SNAP_MAX];  /* in scan order   */
+static struct pci_snap *snap_slot [PCI_SNAP_MAX];  /* by bus/devfn    */
+static struct pci_snap *snap_id   [PCI_SNAP_MAX];  /* by vendor/device */
+static struct pci_snap *snap_cls  [PCI_SNAP_MAX];  /* by class        */
+static int              snap_num   = 0;
+static int              snap_ready = 0;   /* indexes are built        */
+static int              snap_valid = 0;   /* file matched the hardware */
+static DWORD            snap_bus [256/32]; /* buses fully scanned     */
+static const char      *snap_file = NULL;
+
+struct pci_snap_stats pci_snap_stats;
+
+/*
+ * Header registers that may be cached, by header type. Never the
+ * command/status dword; for bridges not the one holding the
+ * secondary status either.
+ */
+static WORD snap_cacheable (BYTE hdr_type)
+{
+  switch (hdr_type & 0x7F)
+  {
+    case PCI_HEADER_TYPE_NORMAL:
+         return (0xFFFD);
+    case PCI_HEADER_TYPE_BRIDGE:
+         return (0xFF7D);          /* not 0x1C-0x1F */
+    case PCI_HEADER_TYPE_CARDBUS:
+         return (0xFFDD);          /* not 0x14-0x17 */
+  }
+  return (0x000D);                 /* IDs, class and header type */
+}
+
+static __inline int snap_key (BYTE bus, BYTE devfn)
+{
+  return ((bus << 8) + devfn);
+}
+
+static __inline int bus_known (BYTE bus)
+{
+  return (snap_bus[bus >> 5] & (1UL << (bus & 31))) != 0;
+}
+
+/*
+ * Find the snapshot of 'bus/devfn'. The slot index is sorted once the
+ * scan is done; before that the table is searched in scan order.
+ */
+struct pci_snap *pci_snap_lookup (BYTE bus, BYTE devfn)
+{
+  int key = snap_key (bus, devfn);
+  int i, lo, hi;
+
+  if (!snap_ready)
+  {
+    for (i = 0; i < snap_num; i++)
+        if (snap_key(snap_tab[i]->bus, snap_tab[i]->devfn) == key)
+           return (snap_tab[i]);
+    return (NULL);
+  }
+
+  lo = 0;
+  hi = snap_num - 1;
+  while (lo <= hi)
+  {
+    struct pci_snap *snap;
+    int    k;
+
+    i    = (lo + hi) / 2;
+    snap = snap_slot[i];
+    k    = snap_key (snap->bus, snap->devfn);
+    if (k == key)
+       return (snap);
+    if (k < key)
+         lo = i + 1;
+    else hi = i - 1;
+  }
+  return (NULL);
+}
+
+/*
+ * Walk the capability list of a new snapshot. Reads go straight to
+ * the hardware; the list itself lies outside the header.
+ */
+static void snap_read_caps (struct pci_snap *snap, DWORD status_cmd)
+{
+  DWORD val;
+  BYTE  ptr;
+  int   loops = 48;   /* a broken list may loop */
+
+  snap->num_caps = 0;
+  if (!((status_cmd >> 16) & CAP_LIST_STATUS))
+     return;
+
+  if ((snap->hdr_type & 0x7F) == PCI_HEADER_TYPE_CARDBUS)
+       pcibios_read_config_raw (snap->bus, snap->devfn, CAP_LIST_PTR_CB, &val);
+  else pcibios_read_config_raw (snap->bus, snap->devfn, CAP_LIST_PTR, &val);
+
+  for (ptr = val & 0xFC; ptr >= 0x40 && loops--; ptr = (val >> 8) & 0xFC)
+  {
+    if (pcibios_read_config_raw (snap->bus, snap->devfn, ptr, &val))
+       break;
+    if (snap->num_caps >= PCI_SNAP_CAPS)
+       break;
+    snap->cap [snap->num_caps][0] = val & 0xFF;
+    snap->cap [snap->num_caps][1] = ptr;
+    snap->num_caps++;
+  }
+}
+
+static void snap_set_ids (struct pci_snap *snap)
+{
+  snap->vendor    = snap->cfg[0] & 0xFFFF;
+  snap->device    = snap->cfg[0] >> 16;
+  snap->class     = snap->cfg[2] >> 8;
+  snap->hdr_type  = (snap->cfg[3] >> 16) & 0xFF;
+  snap->cacheable = snap_cacheable (snap->hdr_type);
+}
+
+/*
+ * Fetch header register 'reg' of 'snap' from the hardware.
+ */
+static int snap_fill (struct pci_snap *snap, int reg)
+{
+  if (pcibios_read_config_raw (snap->bus, snap->devfn, reg << 2, &snap->cfg[reg]))
+     return (0);
+  snap->cached |= (1 << reg);
+  pci_snap_stats.fills++;
+  return (1);
+}
+
+/*
+ * Called by pci_scan_bus() for each function found. Records its
+ * header and capabilities, unless loaded from the snapshot file.
+ */
+void pci_snap_add (BYTE bus, BYTE devfn)
+{
+  struct pci_snap *snap = pci_snap_lookup (bus, devfn);
+  DWORD  status_cmd;
+  int    reg;
+
+  if (!snap)
+  {
+    if (snap_num >= PCI_SNAP_MAX)
+       return;
+    snap = k_calloc (sizeof(*snap), 1);
+    if (!snap)
+    {
+      printk ("pci: out of memory for snapshot.\n");
+      return;
+    }
+    snap->bus   = bus;
+    snap->devfn = devfn;
+    snap->order = -1;
+    if (!snap_fill(snap, 3))
+    {
+      k_free (snap);
+      return;
+    }
+    snap_set_ids (snap);
+    if (!pcibios_read_config_raw (bus, devfn, PCI_COMMAND, &status_cmd))
+       snap_read_caps (snap, status_cmd);
+    snap_tab [snap_num++] = snap;
+    snap_ready = 0;   /* indexes are stale until pci_snap_done() */
+  }
+
+  for (reg = 0; reg < PCI_SNAP_HDR_WORDS; reg++)
+      if ((snap->cacheable & ~snap->cached) & (1 << reg))
+         snap_fill (snap, reg);
+  snap_set_ids (snap);
+  snap->scanned = 1;
+}
+
+/*
+ * Called by pci_scan_bus() when it has probed every slot on 'bus'.
+ * From now on an empty slot there reads as all ones.
+ */
+void pci_snap_bus_done (BYTE bus)
+{
+  snap_bus [bus >> 5] |= (1UL << (bus & 31));
+}
+
+/*
+ * Answer a config read of 'size' bytes from the snapshot. Returns 1
+ * with '*val' set, or 0 if the hardware must be read.
+ */
+int pci_snap_read (BYTE bus, BYTE devfn, BYTE where, int size, DWORD *val)
+{
+  struct pci_snap *snap;
+  int    reg = where >> 2;
+
+  if (where & (size-1))
+     return (0);
+
+  snap = pci_snap_lookup (bus, devfn);
+  if (!snap)
+  {
+    if (!bus_known(bus))
+       return (0);
+    *val = 0xFFFFFFFF;
+  }
+  else
+  {
+    if (reg >= PCI_SNAP_HDR_WORDS || !(snap->cacheable & (1 << reg)))
+       return (0);
+    if (!(snap->cached & (1 << reg)) && !snap_fill(snap, reg))
+       return (0);
+    *val = snap->cfg[reg] >> (8 * (where & 3));
+  }
+
+  if (size == 1)
+     *val &= 0xFF;
+  else if (size == 2)
+     *val &= 0xFFFF;
+  pci_snap_stats.hits++;
+  return (1);
+}
+
+/*
+ * Called after a config write. The register written is dropped from
+ * the snapshot; BAR sizing and power-state changes make the value
+ * read back differ from the one written.
+ */
+void pci_snap_write (BYTE bus, BYTE devfn, BYTE where)
+{
+  struct pci_snap *snap = pci_snap_lookup (bus, devfn);
+
+  if (!snap)
+     return;
+  if ((where >> 2) < PCI_SNAP_HDR_WORDS)
+       snap->cached &= ~(1 << (where >> 2));
+  else snap->cached = 0;
+  pci_snap_stats.drops++;
+}
+
+/*
+ * Offset of capability 'id' of 'bus/devfn', 0 if it has none or -1
+ * if the snapshot can't tell.
+ */
+int pci_snap_find_cap (BYTE bus, BYTE devfn, int id)
+{
+  const struct pci_snap *snap;
+  int   i;
+
+  if (!snap_ready)
+     return (-1);
+
+  snap = pci_snap_lookup (bus, devfn);
+  if (!snap)
+     return (-1);
+
+  for (i = 0; i < snap->num_caps; i++)
+      if (snap->cap[i][0] == id)
+         return (snap->cap[i][1]);
+  return (snap->num_caps < PCI_SNAP_CAPS ? 0 : -1);  /* list may be longer */
+}
+
+static int cmp_slot (const void *_a, const void *_b)
+{
+  const struct pci_snap *a = *(const struct pci_snap**) _a;
+  const struct pci_snap *b = *(const struct pci_snap**) _b;
+
+  return (snap_key(a->bus, a->devfn) - snap_key(b->bus, b->devfn));
+}
+
+static int same_id (const struct pci_snap *a, const struct pci_snap *b)
+{
+  return (a->vendor == b->vendor && a->device == b->device);
+}
+
+static int same_class (const struct pci_snap *a, const struct pci_snap *b)
+{
+  return (a->class == b->class);
+}
+
+static int cmp_id (const void *_a, const void *_b)
+{
+  const struct pci_snap *a = *(const struct pci_snap**) _a;
+  const struct pci_snap *b = *(const struct pci_snap**) _b;
+
+  if (a->vendor != b->vendor)
+     return (a->vendor - b->vendor);
+  if (a->device != b->device)
+     return (a->device - b->device);
+  return (a->order - b->order);
+}
+
+static int cmp_class (const void *_a, const void *_b)
+{
+  const struct pci_snap *a = *(const struct pci_snap**) _a;
+  const struct pci_snap *b = *(const struct pci_snap**) _b;
+
+  if (a->class != b->class)
+     return (a->class < b->class ? -1 : 1);
+  return (a->order - b->order);
+}
+
+/*
+ * The 'index'th device matching 'key' in index 'idx', starting at
+ * position 'from' (or the first match if -1). A 'key' with order -1
+ * sorts before every function with the same IDs or class.
+ */
+static struct pci_snap *find_nth (struct pci_snap **idx, struct pci_snap *key,
+                                  int (*cmp)(const void*, const void*),
+                                  int (*same)(const struct pci_snap*,
+                                              const struct pci_snap*),
+                                  int from, int index)
+{
+  int lo = 0, hi = snap_num;
+
+  if (from < 0)
+  {
+    key->order = -1;
+    while (lo < hi)
+    {
+      int mid = (lo + hi) / 2;
+
+      if ((*cmp) (&idx[mid], &key) < 0)
+           lo = mid + 1;
+      else hi = mid;
+    }
+    from = lo;
+  }
+
+  for ( ; from < snap_num && (*same)(idx[from], key); from++)
+      if (idx[from]->dev && index-- == 0)
+         return (idx[from]);
+  return (NULL);
+}
+
+int pci_snap_find_device (WORD vendor, WORD device, WORD index,
+                          BYTE *bus, BYTE *devfn)
+{
+  struct pci_snap key, *snap;
+
+  if (!snap_ready)
+     return (PCIBIOS_FUNC_NOT_SUPPORTED);
+
+  key.vendor = vendor;
+  key.device = device;
+  snap = find_nth (snap_id, &key, cmp_id, same_id, -1, index);
+  if (!snap)
+     return (PCIBIOS_DEVICE_NOT_FOUND);
+  *bus   = snap->bus;
+  *devfn = snap->devfn;
+  return (PCIBIOS_SUCCESSFUL);
+}
+
+int pci_snap_find_class (unsigned class_code, WORD index, BYTE *bus, BYTE *devfn)
+{
+  struct pci_snap key, *snap;
+
+  if (!snap_ready)
+     return (PCIBIOS_FUNC_NOT_SUPPORTED);
+
+  key.class = class_code;
+  snap = find_nth (snap_cls, &key, cmp_class, same_class, -1, index);
+  if (!snap)
+     return (PCIBIOS_DEVICE_NOT_FOUND);
+  *bus   = snap->bus;
+  *devfn = snap->devfn;
+  return (PCIBIOS_SUCCESSFUL);
+}
+
+/*
+ * For pci_find_device() and pci_find_class(); the device after 'from'
+ * (or the first if NULL) with the same IDs or class.
+ */
+struct pci_dev *pci_snap_next_device (unsigned vendor, unsigned device,
+                                      const struct pci_dev *from)
+{
+  struct pci_snap key, *snap;
+  int    pos = -1;
+
+  key.vendor = vendor;
+  key.device = device;
+  if (from)
+     pos = ((const struct pci_snap*)from->sysdata)->id_pos + 1;
+  snap = find_nth (snap_id, &key, cmp_id, same_id, pos, 0);
+  return (snap ? snap->dev : NULL);
+}
+
+struct pci_dev *pci_snap_next_class (unsigned class, const struct pci_dev *from)
+{
+  struct pci_snap key, *snap;
+  int    pos = -1;
+
+  key.class = class;
+  if (from)
+     pos = ((const struct pci_snap*)from->sysdata)->class_pos + 1;
+  snap = find_nth (snap_cls, &key, cmp_class, same_class, pos, 0);
+  return (snap ? snap->dev : NULL);
+}
+
+static DWORD snap_sum (DWORD sum, DWORD val)
+{
+  return (((sum << 1) | (sum >> 31)) + val);
+}
+
+static void snap_to_rec (const struct pci_snap *snap, DWORD *rec)
+{
+  int i;
+
+  rec[0] = snap->bus + (snap->devfn << 8) + (snap->num_caps << 16);
+  for (i = 0; i < PCI_SNAP_HDR_WORDS; i++)
+      rec[1+i] = (snap->cached & (1 << i)) ? snap->cfg[i] : 0;
+  for (i = 0; i < PCI_SNAP_CAPS; i += 2)
+      rec[1+PCI_SNAP_HDR_WORDS+i/2] = snap->cap[i][0]   + (snap->cap[i][1] << 8) +
+                                      (snap->cap[i+1][0] << 16) +
+                                      (snap->cap[i+1][1] << 24);
+}
+
+static void snap_save (void)
+{
+  DWORD hdr [3 + DIM(snap_bus)];
+  DWORD rec [PCI_SNAP_REC_WORDS];
+  DWORD sum = 0;
+  FILE *fil;
+  int   i, j, ok;
+
+  fil = fopen (snap_file, "wb");
+  if (!fil)
+  {
+    printk ("pci: cannot write `%s'\n", snap_file);
+    return;
+  }
+
+  hdr[0] = PCI_SNAP_MAGIC;
+  hdr[1] = snap_num;
+  hdr[2] = 0;                         /* checksum, filled in below */
+  memcpy (hdr+3, snap_bus, sizeof(snap_bus));
+  ok = fwrite (hdr, sizeof(hdr), 1, fil) == 1;
+
+  for (i = 0; ok && i < snap_num; i++)
+  {
+    struct pci_snap *snap = snap_tab[i];
+
+    for (j = 0; j < PCI_SNAP_HDR_WORDS; j++)
+        if ((snap->cacheable & ~snap->cached) & (1 << j))
+           snap_fill (snap, j);
+    snap_to_rec (snap, rec);
+    for (j = 0; j < PCI_SNAP_REC_WORDS; j++)
+        sum = snap_sum (sum, rec[j]);
+    ok = fwrite (rec, sizeof(rec), 1, fil) == 1;
+  }
+
+  hdr[2] = sum;
+  if (ok)
+     ok = (fseek (fil, 0, SEEK_SET) == 0 && fwrite (hdr, sizeof(hdr), 1, fil) == 1);
+  fclose (fil);
+  if (!ok)
+  {
+    printk ("pci: error writing `%s'\n", snap_file);
+    remove (snap_file);
+  }
+}
+
+/*
+ * Check one loaded function against the hardware. The registers read
+ * are kept; the others are read again by pci_snap_add().
+ */
+static int snap_check (struct pci_snap *snap)
+{
+  const DWORD *saved = snap->cfg;
+  DWORD  val;
+  int    reg, last_bar;
+
+  switch (snap->hdr_type & 0x7F)
+  {
+    case PCI_HEADER_TYPE_NORMAL:
+         last_bar = 9;
+         break;
+    case PCI_HEADER_TYPE_BRIDGE:
+         last_bar = 5;
+         break;
+    default:
+         last_bar = 4;
+         break;
+  }
+
+  for (reg = 0; reg <= last_bar; reg++)
+  {
+    if (reg == 1)
+       continue;
+    if (pcibios_read_config_raw (snap->bus, snap->devfn, reg << 2, &val))
+       return (0);
+    if (reg == 3 ? (((val ^ saved[reg]) >> 16) & 0x7F) : val != saved[reg])
+       return (0);
+    snap->cfg[reg] = val;
+  }
+  snap->cached = ((2 << last_bar) - 1) & snap->cacheable;
+  return (1);
+}
+
+static void snap_free (void)
+{
+  int i;
+
+  for (i = 0; i < snap_num; i++)
+      k_free (snap_tab[i]);
+  snap_num = 0;
+  memset (snap_bus, 0, sizeof(snap_bus));
+}
+
+/*
+ * Load and check the snapshot file. Returns 1 if it matches the
+ * hardware.
+ */
+static int snap_load (void)
+{
+  DWORD hdr [3 + DIM(snap_bus)];
+  DWORD rec [PCI_SNAP_REC_WORDS];
+  DWORD sum = 0;
+  FILE *fil = fopen (snap_file, "rb");
+  int   i, j, ok;
+
+  if (!fil)
+     return (0);
+
+  ok = fread (hdr, sizeof(hdr), 1, fil) == 1 &&
+       hdr[0] == PCI_SNAP_MAGIC && hdr[1] <= PCI_SNAP_MAX;
+
+  for (i = 0; ok && i < (int)hdr[1]; i++)
+  {
+    struct pci_snap *snap;
+
+    if (fread (rec, sizeof(rec), 1, fil) != 1)
+    {
+      ok = 0;
+      break;
+    }
+    for (j = 0; j < PCI_SNAP_REC_WORDS; j++)
+        sum = snap_sum (sum, rec[j]);
+
+    snap = k_calloc (sizeof(*snap), 1);
+    if (!snap)
+    {
+      ok = 0;
+      break;
+    }
+    snap_tab [snap_num++] = snap;
+    snap->bus      = rec[0] & 0xFF;
+    snap->devfn    = (rec[0] >> 8) & 0xFF;
+    snap->num_caps = (rec[0] >> 16) & 0xFF;
+    snap->order    = -1;
+    for (j = 0; j < PCI_SNAP_HDR_WORDS; j++)
+        snap->cfg[j] = rec[1+j];
+    for (j = 0; j < PCI_SNAP_CAPS; j++)
+    {
+      DWORD caps = rec [1 + PCI_SNAP_HDR_WORDS + j/2] >> (16 * (j & 1));
+
+      snap->cap[j][0] = caps & 0xFF;
+      snap->cap[j][1] = (caps >> 8) & 0xFF;
+    }
+    snap_set_ids (snap);
+  }
+  fclose (fil);
+
+  if (ok && sum != hdr[2])
+     ok = 0;
+
+  for (i = 0; ok && i < snap_num; i++)
+      ok = snap_check (snap_tab[i]);
+
+  if (!ok)
+  {
+    PRINTK (("pci: snapshot `%s' doesn't match, rescanning\n", snap_file));
+    snap_free();
+    return (0);
+  }
+  memcpy (snap_bus, hdr+3, sizeof(snap_bus));
+  return (1);
+}
+
+/*
+ * Called by pci_init() before the bus is scanned.
+ */
+void pci_snap_init (void)
+{
+  snap_ready = snap_valid = 0;
+  snap_free();
+  memset (&pci_snap_stats, 0, sizeof(pci_snap_stats));
+
+  snap_file = getenv (PCI_SNAP_PARAM);
+  if (snap_file && *snap_file)
+       snap_valid = snap_load();
+  else snap_file = NULL;
+}
+
+/*
+ * Called by pci_init() after the scan. Drops what the scan didn't find
+ * again, links the snapshot to pci_devices and builds the indexes.
+ */
+void pci_snap_done (void)
+{
+  struct pci_dev *dev;
+  int    i, j, order = 0;
+
+  for (i = j = 0; i < snap_num; i++)
+  {
+    if (!snap_tab[i]->scanned)   /* loaded, but gone */
+    {
+      k_free (snap_tab[i]);
+      snap_valid = 0;
+      continue;
+    }
+    snap_tab [j++] = snap_tab[i];
+  }
+  snap_num = j;
+
+  for (dev = pci_devices; dev; dev = dev->next)
+  {
+    struct pci_snap *snap = pci_snap_lookup (dev->bus->number, dev->devfn);
+
+    dev->sysdata = snap;
+    if (snap)
+    {
+      snap->dev   = dev;
+      snap->order = order++;
+    }
+  }
+
+  for (dev = pci_devices; dev; dev = dev->next)
+      if (!dev->sysdata)   /* snapshot table was full */
+         return;
+
+  memcpy (snap_slot, snap_tab, snap_num * sizeof(snap_tab[0]));
+  memcpy (snap_id,   snap_tab, snap_num * sizeof(snap_tab[0]));
+  memcpy (snap_cls,  snap_tab, snap_num * sizeof(snap_tab[0]));
+  qsort (snap_slot, snap_num, sizeof(snap_slot[0]), cmp_slot);
+  qsort (snap_id,   snap_num, sizeof(snap_id[0]),   cmp_id);
+  qsort (snap_cls,  snap_num, sizeof(snap_cls[0]),  cmp_class);
+  for (i = 0; i < snap_num; i++)
+  {
+    snap_id[i]->id_pos     = i;
+    snap_cls[i]->class_pos = i;
+  }
+  snap_ready = 1;
+
+  PRINTK (("pci: snapshot of %d functions%s\n", snap_num,
+           snap_valid ? " (from file)" : ""));
+
+  if (snap_file && !snap_valid)
+     snap_save();
+}
+
+/*
+ * Non-zero when pci_find_xx() and pcibios_find_xx() use the snapshot.
+ */
+int pci_snap_active (void)
+{
+  return (snap_ready);
+}
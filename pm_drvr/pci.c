@@ -968,6 +968,13 @@ struct pci_dev *pci_find_slot (unsigned bus, unsigned devfn)
 {
   struct pci_dev *dev;
 
+  if (pci_snap_active())
+  {
+    struct pci_snap *snap = pci_snap_lookup (bus, devfn);
+
+    return (snap ? snap->dev : NULL);
+  }
+
   for (dev = pci_devices; dev; dev = dev->next)
       if (dev->bus->number == bus && dev->devfn == devfn)
          break;
@@ -976,6 +983,9 @@ struct pci_dev *pci_find_slot (unsigned bus, unsigned devfn)
 
 struct pci_dev *pci_find_device (unsigned vendor, unsigned device, struct pci_dev *from)
 {
+  if (pci_snap_active())
+     return pci_snap_next_device (vendor, device, from);
+
   if (!from)
        from = pci_devices;
   else from = from->next;
@@ -986,6 +996,9 @@ struct pci_dev *pci_find_device (unsigned vendor, unsigned device, struct pci_de
 
 struct pci_dev *pci_find_class (unsigned class, struct pci_dev *from)
 {
+  if (pci_snap_active())
+     return pci_snap_next_class (class, from);
+
   if (!from)
        from = pci_devices;
   else from = from->next;
@@ -1110,6 +1123,10 @@ int pci_scan_bus (struct pci_bus *bus)
       continue;
     }
 
+    /* Record the header; the reads below are served from it
+     */
+    pci_snap_add (bus->number, devfn);
+
     dev = k_calloc (sizeof(*dev), 1);
     if (!dev)
     {
@@ -1215,6 +1232,8 @@ int pci_scan_bus (struct pci_bus *bus)
 #endif
   }
 
+  pci_snap_bus_done (bus->number);
+
 #if 0
   /* After performing arch-dependent fixup of the bus, look behind
    * all PCI-to-PCI bridges on this bus.
@@ -1362,6 +1381,7 @@ struct pci_bus *pci_scan_peer_bridge (int bus)
   pci_root.next  = b;
   b->number      = b->secondary = bus;
   b->subordinate = pci_scan_bus (b);
+  pci_snap_done();
   return (b);
 }
 
@@ -1389,7 +1409,9 @@ int pci_init (void)
   PRINTK (("pci: Probing PCI hardware\n"));
 
   memset (&pci_root, 0, sizeof(pci_root));
+  pci_snap_init();
   pci_root.subordinate = pci_scan_bus (&pci_root);
+  pci_snap_done();
 
 #if 0
   /* give BIOS a chance to apply platform specific fixes:
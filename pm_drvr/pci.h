@@ -1318,4 +1318,59 @@ const char *pci_strclass  (unsigned class);
 const char *pci_strvendor (unsigned vendor);
 const char *pci_strdev    (unsigned vendor, unsigned device);
 
+/*
+ * Snapshot of the config header of each function, taken by
+ * pci_scan_bus(). See pci-snap.c
+ */
+#define PCI_SNAP_PARAM     "PCAP_PCISNAP"  /* "set PCAP_PCISNAP=c:\pci.snp" */
+#define PCI_SNAP_MAX       256             /* functions kept */
+#define PCI_SNAP_CAPS      8               /* capabilities kept per function */
+#define PCI_SNAP_HDR_WORDS 16              /* 0x00 - 0x3F */
+
+struct pci_snap {
+       struct pci_dev *dev;       /* NULL if pci_scan_bus() ignored it */
+       BYTE     bus;
+       BYTE     devfn;
+       BYTE     hdr_type;
+       BYTE     num_caps;
+       WORD     vendor;
+       WORD     device;
+       unsigned class;            /* 3 bytes: (base,sub,prog-if) */
+       WORD     cacheable;        /* bit n: cfg[n] may be cached */
+       WORD     cached;           /* bit n: cfg[n] is valid */
+       int      scanned;          /* seen by pci_scan_bus() */
+       int      order;            /* position in pci_devices */
+       int      id_pos;           /* position in vendor/device index */
+       int      class_pos;        /* position in class index */
+       BYTE     cap [PCI_SNAP_CAPS][2];  /* capability id, offset */
+       DWORD    cfg [PCI_SNAP_HDR_WORDS];
+     };
+
+struct pci_snap_stats {
+       DWORD  hits;               /* reads answered */
+       DWORD  fills;              /* registers read from the hardware */
+       DWORD  drops;              /* writes that dropped a register */
+     };
+
+extern struct pci_snap_stats pci_snap_stats;
+
+void             pci_snap_init       (void);
+void             pci_snap_add        (BYTE bus, BYTE devfn);
+void             pci_snap_bus_done   (BYTE bus);
+void             pci_snap_done       (void);
+int              pci_snap_active     (void);
+struct pci_snap *pci_snap_lookup     (BYTE bus, BYTE devfn);
+int              pci_snap_read       (BYTE bus, BYTE devfn, BYTE where,
+                                      int size, DWORD *val);
+void             pci_snap_write      (BYTE bus, BYTE devfn, BYTE where);
+int              pci_snap_find_cap   (BYTE bus, BYTE devfn, int id);
+int              pci_snap_find_device(WORD vendor, WORD device, WORD index,
+                                      BYTE *bus, BYTE *devfn);
+int              pci_snap_find_class (unsigned class_code, WORD index,
+                                      BYTE *bus, BYTE *devfn);
+struct pci_dev  *pci_snap_next_device(unsigned vendor, unsigned device,
+                                      const struct pci_dev *from);
+struct pci_dev  *pci_snap_next_class (unsigned class,
+                                      const struct pci_dev *from);
+
 #endif /* __PCI_H */
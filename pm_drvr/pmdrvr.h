@@ -41,6 +41,7 @@
 #endif
 
 struct device;  /* forward */
+struct tx_frag;
 
 #include "iface.h"
 #include "lock.h"
@@ -176,6 +177,69 @@ typedef struct device {
         /* Multicast stuff */
         int   mc_count;           /* Number of installed mcasts */
         ETHER mc_list[MAX_MCAST]; /* Multicast mac addresses    */
+
+        /* The address filter before netif_filter_offload() changed it.
+         */
+        int   hwf_saved;
+        WORD  hwf_flags;
+        int   hwf_mc_count;
+        ETHER hwf_mc_list[MAX_MCAST];
+
+        /* Zero-copy receive (see rxring.h). Set by the capture layer;
+         * rx_slot_size == 0 means every frame is copied to get_rx_buf().
+         * swap_rx_buf (NULL,0,0)      -> fetch an empty slot
+         * swap_rx_buf (slot,ofs,len)  -> enqueue filled slot, return new one
+         *                                (NULL and keep slot if queue full)
+         * swap_rx_buf (slot,0,0)      -> return an unused slot
+         */
+        BYTE *(*swap_rx_buf) (BYTE *slot, int ofs, int len);
+        int    rx_slot_size;
+
+        /* Polled receive. A driver that sets 'poll' may call
+         * netif_rx_schedule() from its ISR on a receive burst and mask
+         * its Rx interrupt. The capture loop then calls netif_poll()
+         * until poll() handles less than 'budget' frames; the driver
+         * then calls netif_rx_complete() and unmasks Rx again.
+         * Drivers only do this if the capture layer has set 'poll_ok'
+         * before open() to say it calls netif_poll(); it is 0 by default
+         * and receive then stays interrupt driven.
+         */
+        int  (*poll) (struct device *dev, int budget);
+        int    poll_ok;
+        volatile int polling;
+        DWORD  irq_count;      /* interrupts taken         */
+        DWORD  poll_count;     /* poll() calls             */
+        DWORD  poll_frames;    /* frames received by poll  */
+
+        /* Interrupt coalescing. set_coalesce() makes the NIC interrupt
+         * after 'frames' frames or 'usecs' micro-sec, whichever comes
+         * first; frames <= 1 turns it off. With 'coal_adaptive' set,
+         * netif_coalesce_tune() picks the values from the Rx rate.
+         */
+        int  (*set_coalesce) (struct device *dev, int frames, int usecs);
+        int    coal_frames;
+        int    coal_usecs;
+        int    coal_adaptive;
+        DWORD  coal_rx_last;   /* Rx count at last tune    */
+        DWORD  coal_time_last; /* jiffies at last tune     */
+
+        /* Early drop in PIO drivers. Set by the capture layer. The
+         * driver reads the first 'rx_peek_len' bytes of a frame and
+         * calls rx_prefilter(); if that returns 0 the rest of the frame
+         * is discarded on the NIC without being read. rx_prefilter()
+         * must accept a frame it can't judge from 'hdr_len' bytes.
+         */
+        int  (*rx_prefilter) (const BYTE *hdr, int hdr_len, int frame_len);
+        int    rx_peek_len;
+
+        /* Scatter-gather transmit (see txsg.h). Set by a driver whose
+         * NIC can DMA a frame from up to 'tx_max_frags' fragments;
+         * callers go through netif_xmit_sg().
+         */
+        int  (*xmit_sg) (struct device *dev, const struct tx_frag *frag,
+                         int nfrag, void (*done) (void *arg, int ok),
+                         void *arg);
+        int    tx_max_frags;
       } DEVICE;
 
 /*
@@ -219,6 +283,14 @@ typedef struct net_device_stats {
         DWORD  tx_window_errors;
         DWORD  tx_collisions;
         DWORD  tx_jabbers;
+
+        /* descriptor ring sizes and occupancy high-water marks */
+        DWORD  rx_ring_size;
+        DWORD  rx_ring_hiwater;
+        DWORD  tx_ring_size;
+        DWORD  tx_ring_hiwater;
+
+        DWORD  rx_prefiltered;        /* dropped by dev->rx_prefilter */
       } NET_STATS;
 
 extern int EISA_bus, irq_debug, el3_debug, ei_debug  LOCKED_VAR;
@@ -238,6 +310,27 @@ extern WORD  ntohs (WORD);
 struct device *init_etherdev (struct device *dev, int sizeof_priv);
 void           ether_setup   (struct device *dev);
 void           fddi_setup    (struct device *dev);
+int            netif_poll    (struct device *dev, int budget);
+int            netif_set_coalesce  (struct device *dev, int frames, int usecs);
+void           netif_coalesce_tune (struct device *dev, DWORD rx_frames);
+int            netif_filter_offload (struct device *dev,
+                                     const struct bpf_insn *prog, int len);
+
+#define netif_rx_schedule(dev)  ((dev)->polling = 1)
+#define netif_rx_complete(dev)  ((dev)->polling = 0)
+
+/*
+ * Number of header bytes (a multiple of 4) a PIO driver should read
+ * before calling dev->rx_prefilter() for a frame of 'len' bytes.
+ * 0 means no early drop; read the whole frame.
+ */
+#define RX_PEEK_MAX         128
+#define RX_PEEK_ROUND(n)    ((n) >= RX_PEEK_MAX ? RX_PEEK_MAX : ((n) + 3) & ~3)
+
+#define rx_peek_size(dev,len)                                    \
+        (((dev)->rx_prefilter && (dev)->rx_peek_len > 0 &&       \
+          RX_PEEK_ROUND((dev)->rx_peek_len) < (len)) ?            \
+           RX_PEEK_ROUND((dev)->rx_peek_len) : 0)
 
 #endif /* __PMODE_MAC_DRIVER */
 
@@ -27,6 +27,7 @@ static const char *version = "rtl8139.c:v1.08 6/25/99 Donald Becker "
 #include "bios32.h"
 #include "pci.h"
 #include "module.h"
+#include "txsg.h"
 
 int rtl8139_debug = 1;
 
@@ -48,10 +49,20 @@ static int multicast_filter_limit = 32;
 static int options[MAX_UNITS]     = { -1, -1, -1, -1, -1, -1, -1, -1 };
 static int full_duplex[MAX_UNITS] = { -1, -1, -1, -1, -1, -1, -1, -1 };
 
-/* Size of the in-memory receive ring.
+/* Size of the in-memory receive ring. The chip runs in WRAP mode; a
+ * frame reaching the end of the ring continues into an overflow area
+ * behind it instead of at the start, so every frame is contiguous.
+ * WRAP mode doesn't work with the 64K ring.
  */
-#define RX_BUF_LEN_IDX  3       /* 0==8K, 1==16K, 2==32K, 3==64K */
+#define RX_BUF_LEN_IDX  2       /* 0==8K, 1==16K, 2==32K */
 #define RX_BUF_LEN     (8192 << RX_BUF_LEN_IDX)
+#define RX_BUF_WRAP    (ETH_MAX+16)              /* overflow area */
+#define RX_BUF_TOT_LEN (RX_BUF_LEN + 16 + RX_BUF_WRAP)
+
+/* "set PCAP_RTLDIRECT=1" makes peek_rx_buf() return frames in place in
+ * the receive ring; the chip may reuse the space after release_rx_buf().
+ */
+#define RTL_DIRECT_PARAM "PCAP_RTLDIRECT"
 
 /* Size of the Tx bounce buffers -- must be at least (dev->mtu+14+4).
  */
@@ -68,6 +79,10 @@ static int full_duplex[MAX_UNITS] = { -1, -1, -1, -1, -1, -1, -1, -1 };
 #define RX_DMA_BURST    4       /* Maximum PCI burst, '4' is 256 bytes */
 #define TX_DMA_BURST    4       /* Calculate as 16<<val. */
 
+#define RX_CFG_WRAP     0x80    /* RxConfig bit 7 */
+#define RX_CONFIG      ((RX_FIFO_THRESH << 13) | (RX_BUF_LEN_IDX << 11) | \
+                        (RX_DMA_BURST << 8) | RX_CFG_WRAP)
+
 /* Operational parameters that usually are not changed.
  * Time in jiffies before concluding the transmitter is hung.
  */
@@ -300,12 +315,15 @@ struct rtl8129_private {
        struct net_device_stats stats;
        struct timer_list       timer;  /* Media selection timer. */
        UINT           cur_rx;          /* Index into the Rx buffer of next Rx pkt. */
+       UINT           rx_held;         /* cur_rx after a peeked frame, 0 if none. */
        UINT           cur_tx, dirty_tx, tx_flag;
        DWORD          tx_full;         /* The Tx queue is full. */
 
        /* The saved address of a sent-in-place packet/buffer, for skfree(). */
    //  struct sk_buff *tx_skbuff[NUM_TX_DESC];
        BYTE  *tx_buf[NUM_TX_DESC]; /* Tx bounce buffers */
+       tx_done_fn tx_done[NUM_TX_DESC]; /* xmit_sg() completions */
+       void      *tx_arg[NUM_TX_DESC];
        BYTE  *rx_ring;
        BYTE  *tx_bufs;             /* Tx bounce buffer region. */
        char   phys[4];             /* MII device addresses. */
@@ -316,12 +334,19 @@ struct rtl8129_private {
        UINT   media2:4;            /* Secondary monitored media port. */
        UINT   medialock:1;         /* Don't sense media type. */
        UINT   mediasense:1;        /* Media sensing in progress. */
+       UINT   rx_direct:1;         /* Frames are read in place by the consumer. */
+       int  (*old_peek_rx_buf) (BYTE **buf);
+       int  (*old_release_rx_buf) (BYTE *buf);
      };
 
 
 static int   rtl8129_open       (struct device *dev);
 static void  rtl8129_init_ring  (struct device *dev);
 static int   rtl8129_start_xmit (struct device *dev, const void *buf, int len);
+static int   rtl8129_xmit_sg    (struct device *dev, const struct tx_frag *frag,
+                                 int nfrag, tx_done_fn done, void *arg);
+static void  rtl8129_tx_queue   (struct device *dev, int entry,
+                                 const BYTE *data, int len);
 static void  rtl8129_close      (struct device *dev);
 static void *rtl8129_get_stats  (struct device *dev);
 static int   read_eeprom (long ioaddr, int location, int addr_len);
@@ -334,7 +359,11 @@ static struct device *rtl8129_probe1 (int pci_bus, int pci_devfn,
 
 static void  rtl8129_timer (DWORD data)              LOCKED_FUNC;
 static void  rtl8129_tx_timeout (struct device *dev) LOCKED_FUNC;
+static void  rtl8129_tx_flush (struct device *dev)   LOCKED_FUNC;
 static void  rtl8129_rx (struct device *dev)         LOCKED_FUNC;
+static int   rtl8129_rx_error (struct device *dev, DWORD rx_status) LOCKED_FUNC;
+static int   rtl8129_peek_rx    (BYTE **buf);
+static int   rtl8129_release_rx (BYTE *buf);
 static void  rtl8129_interrupt (int irq)             LOCKED_FUNC;
 static void  set_rx_mode (struct device *dev)        LOCKED_FUNC;
 
@@ -343,6 +372,11 @@ static void  set_rx_mode (struct device *dev)        LOCKED_FUNC;
  */
 static struct device *root_rtl8129_dev = NULL;
 
+/* The device whose frames peek_rx_buf() returns in place. The capture
+ * layer's hooks don't pass a device, so only one can do this.
+ */
+static struct device *rtl_direct_dev = NULL;
+
 /* Ideally we would detect all network cards in slot order.  That would
  * be best done a central PCI probe dispatch, which wouldn't work
  * well when dynamically adding drivers.  So instead we detect just the
@@ -526,7 +560,9 @@ static struct device *rtl8129_probe1 (int pci_bus, int pci_devfn,
    */
   dev->open      = rtl8129_open;
   dev->xmit      = rtl8129_start_xmit;
+  dev->xmit_sg   = rtl8129_xmit_sg;
   dev->close     = rtl8129_close;
+  dev->tx_max_frags = TX_MAX_FRAGS;
   dev->get_stats = rtl8129_get_stats;
   dev->set_multicast_list = set_rx_mode;
   return (dev);
@@ -727,7 +763,7 @@ static int rtl8129_open (struct device *dev)
   }
 
   tp->tx_bufs = k_malloc (TX_BUF_SIZE * NUM_TX_DESC);
-  tp->rx_ring = k_malloc (RX_BUF_LEN + 16);
+  tp->rx_ring = k_malloc (RX_BUF_TOT_LEN);
   if (!tp->tx_bufs || !tp->rx_ring)
   {
     if (tp->tx_bufs)
@@ -752,8 +788,7 @@ static int rtl8129_open (struct device *dev)
   /* Must enable Tx/Rx before setting transfer thresholds!
    */
   outb (CmdRxEnb | CmdTxEnb, ioaddr + ChipCmd);
-  outl ((RX_FIFO_THRESH << 13) | (RX_BUF_LEN_IDX << 11) | (RX_DMA_BURST << 8),
-        ioaddr + RxConfig);
+  outl (RX_CONFIG, ioaddr + RxConfig);
   outl ((TX_DMA_BURST << 8) | 0x03000000, ioaddr + TxConfig);
   tp->tx_flag = (TX_FIFO_THRESH << 11) & 0x003f0000;
 
@@ -780,6 +815,17 @@ static int rtl8129_open (struct device *dev)
 
   outl (VIRT_TO_BUS(tp->rx_ring), ioaddr + RxBuf);
 
+  tp->rx_held = 0;
+  if (getenv(RTL_DIRECT_PARAM) && !rtl_direct_dev)
+  {
+    tp->rx_direct = 1;
+    tp->old_peek_rx_buf    = dev->peek_rx_buf;
+    tp->old_release_rx_buf = dev->release_rx_buf;
+    dev->peek_rx_buf    = rtl8129_peek_rx;
+    dev->release_rx_buf = rtl8129_release_rx;
+    rtl_direct_dev = dev;
+  }
+
   /* Start the chip's Tx and Rx process.
    */
   outl (0, ioaddr + RxMissed);
@@ -979,14 +1025,13 @@ static void rtl8129_tx_timeout (struct device *dev)
       outb (dev->dev_addr[i], ioaddr + MAC0 + i);
 
   outb (0x00, ioaddr + Cfg9346);
-  tp->cur_rx = 0;
+  tp->cur_rx  = 0;
+  tp->rx_held = 0;
 
   /* Must enable Tx/Rx before setting transfer thresholds!
    */
   outb (CmdRxEnb | CmdTxEnb, ioaddr + ChipCmd);
-  outl ((RX_FIFO_THRESH << 13) |
-        (RX_BUF_LEN_IDX << 11) |
-        (RX_DMA_BURST << 8), ioaddr + RxConfig);
+  outl (RX_CONFIG, ioaddr + RxConfig);
   outl ((TX_DMA_BURST << 8), ioaddr + TxConfig);
   set_rx_mode (dev);
 
@@ -1033,6 +1078,11 @@ static void rtl8129_tx_timeout (struct device *dev)
   }
 #endif
 
+  /* The reset restarted the chip at Tx descriptor 0 and dropped the
+   * frames queued.
+   */
+  rtl8129_tx_flush (dev);
+
   dev->tx_start = jiffies;
   tp->stats.tx_errors++;
 
@@ -1057,14 +1107,14 @@ static void rtl8129_init_ring (struct device *dev)
   for (i = 0; i < NUM_TX_DESC; i++)
   {
     // tp->tx_skbuff[i] = 0;
-    tp->tx_buf[i] = &tp->tx_bufs [i*TX_BUF_SIZE];
+    tp->tx_buf[i]  = &tp->tx_bufs [i*TX_BUF_SIZE];
+    tp->tx_done[i] = NULL;
   }
 }
 
 static int rtl8129_start_xmit (struct device *dev, const void *buf, int len)
 {
   struct rtl8129_private *tp = (struct rtl8129_private *) dev->priv;
-  long   ioaddr = dev->base_addr;
   int    entry;
 
   /* Block a timer-based transmit from overlapping.  This could better be
@@ -1076,13 +1126,66 @@ static int rtl8129_start_xmit (struct device *dev, const void *buf, int len)
       rtl8129_tx_timeout (dev);
     return (0);
   }
+  dev->tx_busy = 1;
 
   /* Calculate the next Tx descriptor entry.
    */
   entry = tp->cur_tx % NUM_TX_DESC;
 
   memcpy (tp->tx_buf[entry], buf, len);
-  outl (VIRT_TO_BUS(tp->tx_buf[entry]), ioaddr + TxAddr0 + entry * 4);
+  tp->tx_done[entry] = NULL;
+  rtl8129_tx_queue (dev, entry, tp->tx_buf[entry], len);
+  return (1);
+}
+
+/*
+ * Transmit from a fragment list. The chip reads each frame from one
+ * 32-bit aligned buffer and doesn't pad short frames, so only a
+ * single aligned fragment of at least ETH_MIN bytes is sent in place.
+ * Others are gathered into the Tx bounce buffer.
+ */
+static int rtl8129_xmit_sg (struct device *dev, const struct tx_frag *frag,
+                            int nfrag, tx_done_fn done, void *arg)
+{
+  struct rtl8129_private *tp = (struct rtl8129_private *) dev->priv;
+  const BYTE *data = (const BYTE*) frag[0].data;
+  int   len = tx_frag_len (frag, nfrag);
+  int   entry;
+
+  if (len > TX_BUF_SIZE)
+     return (0);
+
+  if (dev->tx_busy)
+  {
+    if (jiffies - dev->tx_start >= TX_TIMEOUT)
+      rtl8129_tx_timeout (dev);
+    return (0);
+  }
+  dev->tx_busy = 1;
+
+  entry = tp->cur_tx % NUM_TX_DESC;
+
+  if (nfrag > 1 || ((DWORD)data & 3) || len < ETH_MIN)
+  {
+    tx_frag_copy (tp->tx_buf[entry], frag, nfrag);
+    data = tp->tx_buf[entry];
+  }
+  tp->tx_done[entry] = done;
+  tp->tx_arg[entry]  = arg;
+  rtl8129_tx_queue (dev, entry, data, len);
+  return (1);
+}
+
+/*
+ * Give Tx descriptor 'entry' to the chip.
+ */
+static void rtl8129_tx_queue (struct device *dev, int entry,
+                              const BYTE *data, int len)
+{
+  struct rtl8129_private *tp = (struct rtl8129_private *) dev->priv;
+  long   ioaddr = dev->base_addr;
+
+  outl (VIRT_TO_BUS(data), ioaddr + TxAddr0 + entry * 4);
 
   /* Note: the chip doesn't have auto-pad!
    */
@@ -1110,8 +1213,30 @@ static int rtl8129_start_xmit (struct device *dev, const void *buf, int len)
   dev->tx_start = jiffies;
   if (rtl8139_debug > 4)
      printk ("%s: Queued Tx packet at %08X size %d to slot %d.\n",
-             dev->name, (unsigned)tp->tx_buf[entry], len, entry);
-  return (1);
+             dev->name, (unsigned)data, len, entry);
+}
+
+/*
+ * Forget the queued frames after a reset; their owners are told they
+ * weren't sent.
+ */
+static void rtl8129_tx_flush (struct device *dev)
+{
+  struct rtl8129_private *tp = (struct rtl8129_private *) dev->priv;
+  tx_done_fn done;
+  int    entry;
+
+  while (tp->cur_tx - tp->dirty_tx > 0)
+  {
+    entry = tp->dirty_tx++ % NUM_TX_DESC;
+    done  = tp->tx_done[entry];
+    tp->tx_done[entry] = NULL;
+    if (done)
+      (*done) (tp->tx_arg[entry], 0);
+  }
+  tp->dirty_tx = tp->cur_tx = 0;
+  tp->tx_full  = 0;
+  dev->tx_busy = 0;
 }
 
 /*
@@ -1206,6 +1331,14 @@ static void rtl8129_interrupt (int irq)
           tp->stats.tx_packets++;
         }
 
+        if (tp->tx_done[entry])
+        {
+          tx_done_fn done = tp->tx_done[entry];
+
+          tp->tx_done[entry] = NULL;
+          (*done) (tp->tx_arg[entry], !(txstatus & (TxOutOfWindow | TxAborted)));
+        }
+
         if (tp->tx_full)
         {
           /* The ring is no longer full, clear tx_busy.
@@ -1272,8 +1405,15 @@ static void rtl8129_interrupt (int irq)
       if (status & RxOverflow)
       {
         tp->stats.rx_over_errors++;
-        tp->cur_rx = inw (ioaddr + RxBufAddr) % RX_BUF_LEN;
-        outw (tp->cur_rx - 16, ioaddr + RxBufPtr);
+
+        /* With frames read in place the chip resumes when the
+         * consumer releases them.
+         */
+        if (!tp->rx_direct)
+        {
+          tp->cur_rx = inw (ioaddr + RxBufAddr) % RX_BUF_LEN;
+          outw (tp->cur_rx - 16, ioaddr + RxBufPtr);
+        }
       }
       if (status & PCIErr)
       {
@@ -1314,6 +1454,9 @@ static void rtl8129_rx (struct device *dev)
   BYTE  *rx_ring = tp->rx_ring;
   WORD   cur_rx  = tp->cur_rx;
 
+  if (tp->rx_direct)      /* the consumer takes them with peek_rx_buf() */
+     return;
+
   if (rtl8139_debug > 4)
      printk ("%s: In rtl8129_rx(), current %04X BufAddr %04X,"
              " free to %04X, Cmd %02X.\n",
@@ -1337,41 +1480,13 @@ static void rtl8129_rx (struct device *dev)
           printk (" %02X", rx_ring[ring_offset + i]);
       printk (".\n");
     }
-    if (rx_status & RxTooLong)
+    if (rx_status & (RxBadSymbol | RxRunt | RxTooLong | RxCRCErr | RxBadAlign))
     {
-      if (rtl8139_debug > 0)
-         printk ("%s: Oversized Ethernet frame, status %04X!\n",
-                 dev->name, rx_status);
-      tp->stats.rx_length_errors++;
-      /* A.C.: The chip hangs here. */
-    }
-    else if (rx_status & (RxBadSymbol | RxRunt | RxTooLong | RxCRCErr | RxBadAlign))
-    {
-      if (rtl8139_debug > 1)
-         printk ("%s: Ethernet frame had errors, status %04X.\n",
-                 dev->name, rx_status);
-      tp->stats.rx_errors++;
-      if (rx_status & (RxBadSymbol | RxBadAlign))
-         tp->stats.rx_frame_errors++;
-
-      if (rx_status & (RxRunt | RxTooLong))
-         tp->stats.rx_length_errors++;
-
-      if (rx_status & RxCRCErr)
-         tp->stats.rx_crc_errors++;
-
-      /* Reset the receiver, based on RealTek recommendation. (Bug?)
-       */
-      tp->cur_rx = 0;
-      outb (CmdTxEnb, ioaddr + ChipCmd);
-      outb (CmdRxEnb | CmdTxEnb, ioaddr + ChipCmd);
-      outl ((RX_FIFO_THRESH << 13) |
-            (RX_BUF_LEN_IDX << 11) |
-            (RX_DMA_BURST << 8), ioaddr + RxConfig);
-
-      /* A.C.: Reset the multicast list.
-       */
-      set_rx_mode (dev);
+      if (rtl8129_rx_error (dev, rx_status))
+      {
+        cur_rx = 0;
+        continue;
+      }
     }
     else
     {
@@ -1390,28 +1505,9 @@ static void rtl8129_rx (struct device *dev)
         break;
       }
 
-      /* Malloc up new buffer, compatible with net-2e.
-       * Omit the four octet CRC from the length.
+      /* A frame wrapping the ring end continues in the overflow area.
        */
-      if (ring_offset + rx_size + 4 > RX_BUF_LEN)
-      {
-        int semi_count = RX_BUF_LEN - ring_offset - 4;
-
-        memcpy (buf, &rx_ring[ring_offset+4], semi_count);
-        memcpy (buf + rx_size - semi_count, rx_ring, rx_size - semi_count);
-        if (rtl8139_debug > 4)
-        {
-          int i;
-
-          printk ("%s:  Frame wrap @%d", dev->name, semi_count);
-          for (i = 0; i < 16; i++)
-              printk (" %02X", rx_ring[i]);
-          printk (".\n");
-          memset (rx_ring, 0xcc, 16);
-        }
-      }
-      else
-        memcpy (buf, &rx_ring[ring_offset+4], rx_size);
+      memcpy (buf, &rx_ring[ring_offset+4], rx_size);
 
       tp->stats.rx_bytes += rx_size;
       tp->stats.rx_packets++;
@@ -1428,6 +1524,117 @@ static void rtl8129_rx (struct device *dev)
   tp->cur_rx = cur_rx;
 }
 
+/*
+ * Count a bad frame. Returns 1 if the receiver was reset; the ring
+ * starts over at 0 then.
+ */
+static int rtl8129_rx_error (struct device *dev, DWORD rx_status)
+{
+  struct rtl8129_private *tp = (struct rtl8129_private *) dev->priv;
+  long   ioaddr = dev->base_addr;
+
+  if (rx_status & RxTooLong)
+  {
+    if (rtl8139_debug > 0)
+       printk ("%s: Oversized Ethernet frame, status %04X!\n",
+               dev->name, rx_status);
+    tp->stats.rx_length_errors++;
+    /* A.C.: The chip hangs here. */
+    return (0);
+  }
+
+  if (rtl8139_debug > 1)
+     printk ("%s: Ethernet frame had errors, status %04X.\n",
+             dev->name, rx_status);
+  tp->stats.rx_errors++;
+  if (rx_status & (RxBadSymbol | RxBadAlign))
+     tp->stats.rx_frame_errors++;
+
+  if (rx_status & RxRunt)
+     tp->stats.rx_length_errors++;
+
+  if (rx_status & RxCRCErr)
+     tp->stats.rx_crc_errors++;
+
+  /* Reset the receiver, based on RealTek recommendation. (Bug?)
+   */
+  tp->cur_rx  = 0;
+  tp->rx_held = 0;
+  outb (CmdTxEnb, ioaddr + ChipCmd);
+  outb (CmdRxEnb | CmdTxEnb, ioaddr + ChipCmd);
+  outl (RX_CONFIG, ioaddr + RxConfig);
+
+  /* A.C.: Reset the multicast list.
+   */
+  set_rx_mode (dev);
+  return (1);
+}
+
+/*
+ * peek_rx_buf() hook when frames are read in place. Returns the length
+ * of the oldest frame in the ring and sets '*buf' to it, or 0 if there
+ * is none. The frame stays put until rtl8129_release_rx(); peeking
+ * again before that returns the same frame.
+ */
+static int rtl8129_peek_rx (BYTE **buf)
+{
+  struct device          *dev = rtl_direct_dev;
+  struct rtl8129_private *tp;
+  long   ioaddr;
+
+  if (!dev || !dev->start)
+     return (0);
+
+  tp     = (struct rtl8129_private *) dev->priv;
+  ioaddr = dev->base_addr;
+
+  while ((inb (ioaddr + ChipCmd) & 1) == 0)
+  {
+    int   ring_offset = tp->cur_rx % RX_BUF_LEN;
+    DWORD rx_status   = *(DWORD *) (tp->rx_ring + ring_offset);
+    int   rx_size     = rx_status >> 16;
+
+    if (rx_status & (RxBadSymbol | RxRunt | RxTooLong | RxCRCErr | RxBadAlign))
+    {
+      if (!rtl8129_rx_error (dev, rx_status))
+      {
+        tp->cur_rx = (tp->cur_rx + rx_size + 4 + 3) & ~3;
+        outw (tp->cur_rx - 16, ioaddr + RxBufPtr);
+      }
+      continue;
+    }
+    tp->rx_held = (tp->cur_rx + rx_size + 4 + 3) & ~3;
+    *buf = tp->rx_ring + ring_offset + 4;
+    return (rx_size);
+  }
+  return (0);
+}
+
+/*
+ * release_rx_buf() hook when frames are read in place. Gives the space
+ * of the frame last peeked at back to the chip.
+ */
+static int rtl8129_release_rx (BYTE *buf)
+{
+  struct device          *dev = rtl_direct_dev;
+  struct rtl8129_private *tp;
+
+  if (!dev)
+     return (0);
+
+  tp = (struct rtl8129_private *) dev->priv;
+  if (!tp->rx_held)
+     return (0);
+
+  tp->stats.rx_bytes += *(DWORD *) (tp->rx_ring + tp->cur_rx % RX_BUF_LEN) >> 16;
+  tp->stats.rx_packets++;
+  tp->cur_rx  = tp->rx_held;
+  tp->rx_held = 0;
+  outw (tp->cur_rx - 16, dev->base_addr + RxBufPtr);
+  (void) buf;
+  return (1);
+}
+
 static void rtl8129_close (struct device *dev)
 {
   struct rtl8129_private *tp = (struct rtl8129_private *) dev->priv;
@@ -1458,6 +1665,16 @@ static void rtl8129_close (struct device *dev)
   free_irq (dev->irq);
   irq2dev_map[dev->irq] = NULL;
 
+  rtl8129_tx_flush (dev);
+  dev->tx_busy = 1;
+
+  if (tp->rx_direct)
+  {
+    dev->peek_rx_buf    = tp->old_peek_rx_buf;
+    dev->release_rx_buf = tp->old_release_rx_buf;
+    tp->rx_direct  = 0;
+    rtl_direct_dev = NULL;
+  }
   k_free (tp->rx_ring);
   k_free (tp->tx_bufs);
 
@@ -1550,7 +1767,47 @@ static void set_rx_mode (struct device *dev)
 
   /* We can safely update without stopping the chip.
    */
-  outb (rx_mode, ioaddr + RxConfig);
+  outb (rx_mode | RX_CFG_WRAP, ioaddr + RxConfig);
   outl (mc_filter[0], ioaddr + MAR0 + 0);
   outl (mc_filter[1], ioaddr + MAR0 + 4);
 }
+
+
+#ifdef _MODULE
+
+#include <libc/file.h>
+
+struct device rtl8139_dev = {
+              "rtl8139",
+              "RealTek PCI",
+              0,
+              0,0,0,0,0,0,
+              NULL,
+              rtl8139_probe
+            };
+
+#ifndef USE_DXE3
+
+int  errno = 0;
+FILE __dj_stdout = { 0, 0, 0, 0, _IOWRT | _IOFBF, 1 };
+FILE __dj_stderr = { 0, 0, 0, 0, _IOWRT | _IONBF, 2 };
+
+struct libc_import imports;
+#endif
+
+struct device *wlm_main (struct libc_import *li, int debug_level)
+{
+#ifndef USE_DXE3
+  unsigned *src = (unsigned*) li;
+  unsigned *dst = (unsigned*) &imports;
+
+  while (*src)
+    *dst++ = *src++;
+#endif
+
+  if (debug_level > 0)
+     rtl8139_debug = debug_level;
+  _printk_init (1024, NULL);
+  return (&rtl8139_dev);
+}
+#endif
@@ -0,0 +1,105 @@
+/*
+ *  rxearly.c - Read EtherLink III frames while they arrive.
+ *
+ *  See rxearly.h for how the driver and these routines share a frame.
+ */
+
+#include "pmdrvr.h"
+#include "module.h"
+#include "rxring.h"
+#include "rxearly.h"
+
+/*
+ * Get the threshold from the environment and allocate the head
+ * buffer. Returns the threshold in bytes, 0 if early receive is off.
+ */
+int rx_early_init (struct rx_early *rx)
+{
+  int thresh = ring_param (RX_EARLY_PARAM, 0, 0);
+
+  memset (rx, 0, sizeof(*rx));
+  if (thresh <= 0)
+     return (0);
+
+  if (thresh < RX_EARLY_MIN)
+     thresh = RX_EARLY_MIN;
+  if (thresh > RX_EARLY_MAX)
+     thresh = RX_EARLY_MAX;
+
+  rx->buf = k_malloc (RX_EARLY_SIZE);
+  if (!rx->buf)
+     return (0);
+  rx->thresh = thresh & ~3;
+  return (rx->thresh);
+}
+
+void rx_early_free (struct rx_early *rx)
+{
+  if (rx->buf)
+     k_free (rx->buf);
+  rx->buf    = NULL;
+  rx->thresh = 0;
+}
+
+/*
+ * Called on RxEarly when the top frame is still incomplete and
+ * 'avail' bytes of it are in the FIFO at 'port'. Only whole dwords
+ * are read; the rest comes with the next read.
+ */
+void rx_early_read (struct rx_early *rx, int port, int avail)
+{
+  int num = avail & ~3;
+
+  if (num > RX_EARLY_SIZE - rx->len)
+     num = RX_EARLY_SIZE - rx->len;
+  if (num <= 0)
+     return;
+
+  if (rx->len == 0)
+     rx->frames++;
+  rep_insl (port, (DWORD*)(rx->buf + rx->len), num >> 2);
+  rx->len += num;
+  rx->reads++;
+}
+
+/*
+ * Called on RxComplete for a good frame with 'rest' bytes still in
+ * the FIFO. Passes the head and tail on to dev->get_rx_buf() (or
+ * drops the frame if dev->rx_prefilter() rejects it). Returns 1 if
+ * the frame was passed on. The caller pops the frame with RxDiscard.
+ */
+int rx_early_finish (struct rx_early *rx, struct device *dev,
+                     int port, int rest, struct net_device_stats *stats)
+{
+  int   len  = rx->len + rest;
+  int   peek = rx_peek_size (dev, len);
+  BYTE *buf;
+
+  /* The prefilter needs 'peek' bytes of header; read them into the
+   * head buffer if they haven't arrived early.
+   */
+  if (peek > rx->len)
+  {
+    rep_insl (port, (DWORD*)(rx->buf + rx->len), (peek - rx->len) >> 2);
+    rx->len = peek;
+  }
+
+  if (peek && !(*dev->rx_prefilter) (rx->buf, peek, len))
+  {
+    stats->rx_prefiltered++;
+    rx->len = 0;
+    return (0);
+  }
+
+  if (!dev->get_rx_buf || (buf = (*dev->get_rx_buf) (len)) == NULL)
+  {
+    stats->rx_dropped++;
+    rx->len = 0;
+    return (0);
+  }
+
+  memcpy (buf, rx->buf, rx->len);
+  rep_insl (port, (DWORD*)(buf + rx->len), (len - rx->len + 3) >> 2);
+  rx->len = 0;
+  return (1);
+}
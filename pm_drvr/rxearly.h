@@ -0,0 +1,42 @@
+#ifndef __RXEARLY_H
+#define __RXEARLY_H
+
+/*
+ * Early receive for the EtherLink III family (3c509, 3c59x) in PIO
+ * mode.
+ *
+ * Normally the Rx FIFO is read only when a frame is complete, so the
+ * PIO copy adds the whole frame time to the latency, and the next
+ * back-to-back frame may overrun the FIFO meanwhile. With a threshold
+ * set, the NIC raises RxEarly once that many bytes of a frame have
+ * arrived. The driver then calls rx_early_read() to move what is in
+ * the FIFO into 'buf' while the frame is still coming in. On
+ * RxComplete, rx_early_finish() reads the tail straight into the
+ * capture buffer after the head.
+ *
+ * "set PCAP_RXEARLY=n" sets the threshold in bytes; 0 (the default)
+ * turns it off.
+ */
+#define RX_EARLY_PARAM  "PCAP_RXEARLY"
+#define RX_EARLY_MIN    64
+#define RX_EARLY_MAX    1536
+#define RX_EARLY_SIZE   (ETH_MAX+2)   /* 'buf' size, a multiple of 4 */
+
+struct rx_early {
+       int     thresh;     /* RxEarly threshold in bytes, 0 = off  */
+       int     len;        /* bytes of the top frame in 'buf'      */
+       BYTE   *buf;
+       DWORD   frames;     /* frames started before they completed */
+       DWORD   reads;      /* FIFO reads on RxEarly                */
+     };
+
+extern int  rx_early_init   (struct rx_early *rx);
+extern void rx_early_free   (struct rx_early *rx);
+extern void rx_early_read   (struct rx_early *rx, int port, int avail) LOCKED_FUNC;
+extern int  rx_early_finish (struct rx_early *rx, struct device *dev,
+                             int port, int rest,
+                             struct net_device_stats *stats)       LOCKED_FUNC;
+
+#define rx_early_reset(rx)  ((rx)->len = 0)
+
+#endif
@@ -0,0 +1,152 @@
+/*
+ *  rxring.c - Zero-copy receive ring shared by the bus-master drivers.
+ *
+ *  See rxring.h for how the ring and the capture layer trade buffers.
+ */
+
+#include "pmdrvr.h"
+#include "module.h"
+#include "rxring.h"
+
+/*
+ * Return the value for 'unit' from environment variable 'var'
+ * ("n" for all units or "n0,n1,.."), or 'def' if not given.
+ */
+int ring_param (const char *var, int unit, int def)
+{
+  const char *val = getenv (var);
+  char  *end;
+  long   num;
+
+  while (val && *val)
+  {
+    num = strtol (val, &end, 0);
+    if (end == val)
+       break;
+    if (unit == 0 || *end != ',')
+       return (num > 0 ? (int)num : def);
+    val = end + 1;
+    unit--;
+  }
+  return (def);
+}
+
+/*
+ * Setup 'num' receive buffers of 'ofs + size' bytes each. Use capture
+ * slots if the capture layer offers them, else allocate our own.
+ * Returns 0 on success, -ENOMEM on failure.
+ */
+int rx_ring_init (struct rx_ring *ring, struct device *dev,
+                  int num, int size, int ofs)
+{
+  int stride, i;
+
+  memset (ring, 0, sizeof(*ring));
+  ring->dev  = dev;
+  ring->num  = num;
+  ring->size = size;
+  ring->ofs  = ofs;
+  ring->buf  = k_calloc (num, sizeof(BYTE*));
+  if (!ring->buf)
+     return (-ENOMEM);
+
+  if (dev->swap_rx_buf && dev->rx_slot_size >= ofs + size)
+  {
+    for (i = 0; i < num; i++)
+    {
+      ring->buf[i] = (*dev->swap_rx_buf) (NULL, 0, 0);
+      if (!ring->buf[i])
+         break;
+    }
+    if (i == num)
+    {
+      ring->zero_copy = 1;
+      return (0);
+    }
+
+    /* Not enough slots; give back what we got and copy instead.
+     */
+    while (--i >= 0)
+    {
+      (*dev->swap_rx_buf) (ring->buf[i], 0, 0);
+      ring->buf[i] = NULL;
+    }
+  }
+
+  stride = (ofs + size + RX_RING_ALIGN - 1) & ~(RX_RING_ALIGN - 1);
+  ring->pool = k_malloc_aligned (num * stride, RX_RING_ALIGN);
+  if (!ring->pool)
+  {
+    k_free (ring->buf);
+    ring->buf = NULL;
+    return (-ENOMEM);
+  }
+
+  for (i = 0; i < num; i++)
+      ring->buf[i] = ring->pool + i * stride;
+  return (0);
+}
+
+/*
+ * Release the buffers. The NIC must have stopped receiving.
+ */
+void rx_ring_free (struct rx_ring *ring)
+{
+  int i;
+
+  if (ring->zero_copy)
+  {
+    for (i = 0; i < ring->num; i++)
+        if (ring->buf[i])
+           (*ring->dev->swap_rx_buf) (ring->buf[i], 0, 0);
+  }
+  if (ring->pool)
+     k_free_aligned (ring->pool);
+  if (ring->buf)
+     k_free (ring->buf);
+  ring->pool = NULL;
+  ring->buf  = NULL;
+  ring->zero_copy = 0;
+}
+
+/*
+ * Called from the receive interrupt when descriptor 'entry' holds a
+ * good frame of 'len' bytes at offset 'ofs'. Returns 1 if the frame
+ * was passed on, 0 if it was dropped. Either way the descriptor's
+ * buffer is ready to be given back to the NIC; it may have changed so
+ * the caller must reload rx_ring_buf(ring,entry) into the descriptor.
+ */
+int rx_ring_deliver (struct rx_ring *ring, int entry, int len)
+{
+  struct device *dev = ring->dev;
+  BYTE  *buf = ring->buf[entry];
+  BYTE  *slot;
+
+  if (len > ring->size)
+  {
+    ring->dropped++;
+    return (0);
+  }
+
+  if (ring->zero_copy)
+  {
+    slot = (*dev->swap_rx_buf) (buf, ring->ofs, len);
+    if (!slot)
+    {
+      ring->dropped++;    /* capture ring full, reuse this slot */
+      return (0);
+    }
+    ring->buf[entry] = slot;
+    ring->swapped++;
+    return (1);
+  }
+
+  if (dev->get_rx_buf && (slot = (*dev->get_rx_buf)(len)) != NULL)
+  {
+    memcpy (slot, buf + ring->ofs, len);
+    ring->copied++;
+    return (1);
+  }
+  ring->dropped++;
+  return (0);
+}
@@ -0,0 +1,60 @@
+#ifndef __RXRING_H
+#define __RXRING_H
+
+/*
+ * Common receive ring for bus-master drivers.
+ *
+ * Each descriptor of the NIC's receive ring owns one buffer. When a
+ * frame has been DMA'ed into it, rx_ring_deliver() hands the buffer
+ * to the capture layer and gives the descriptor an empty capture slot
+ * in return (dev->swap_rx_buf). The frame is never copied. If the
+ * capture layer doesn't supply slots (or they are too small), the
+ * ring falls back to buffers of its own and copies each frame once
+ * into dev->get_rx_buf() like the other drivers do.
+ *
+ * 'ofs' is room in front of the frame for drivers that keep their
+ * descriptor in the buffer (e.g. the e100 RFD). The capture layer is
+ * told where the frame starts.
+ */
+struct rx_ring {
+       struct device *dev;
+       int     num;        /* number of descriptors                */
+       int     size;       /* max. frame size the NIC may write    */
+       int     ofs;        /* headroom in front of frame           */
+       int     zero_copy;  /* buffers are capture slots            */
+       BYTE  **buf;        /* buffer owned by each descriptor      */
+       BYTE   *pool;       /* our own buffers when copying         */
+       DWORD   swapped;    /* frames handed over without a copy    */
+       DWORD   copied;     /* frames copied to get_rx_buf()        */
+       DWORD   dropped;    /* no room in the capture ring          */
+       int     hiwater;    /* most descriptors filled at once      */
+     };
+
+#define RX_RING_ALIGN  32  /* buffer alignment (cache-line) */
+
+#define rx_ring_buf(ring,entry)  ((ring)->buf[entry])
+
+/*
+ * Record ring occupancy; 'used' descriptors were found busy.
+ */
+#define RING_HIWATER(mark,used)  do {                      \
+                                   if ((int)(used) > (mark)) \
+                                      (mark) = (int)(used);  \
+                                 } while (0)
+
+/*
+ * Ring sizes may be set at load time with the environment variables
+ * below; "set PCAP_RXRING=256" or one value per unit "256,64". Each
+ * driver still clamps the value to what its hardware can handle.
+ */
+#define RX_RING_PARAM  "PCAP_RXRING"
+#define TX_RING_PARAM  "PCAP_TXRING"
+
+extern int  ring_param      (const char *var, int unit, int def);
+
+extern int  rx_ring_init    (struct rx_ring *ring, struct device *dev,
+                             int num, int size, int ofs);
+extern void rx_ring_free    (struct rx_ring *ring);
+extern int  rx_ring_deliver (struct rx_ring *ring, int entry, int len) LOCKED_FUNC;
+
+#endif
@@ -83,11 +83,69 @@
 
 int last_retran;
 
+/*
+ * Hash index over the transmit states, so slhc_compress() needn't
+ * walk the lru list. net/slhc_vj.h is shared with the receive side,
+ * so the index is kept behind the tstate array in the same block.
+ * Slot numbers are < 255; SLHC_NONE ends a chain.
+ */
+#define SLHC_HASH_SIZE 256
+#define SLHC_NONE      0xFF
+
+struct slhc_index {
+  BYTE head[SLHC_HASH_SIZE];  /* first state in each bucket */
+  BYTE hnext[256];            /* next state in the same bucket */
+  BYTE prev[256];             /* lru predecessor; the list is circular */
+};
+
+#define SLHC_INDEX(comp) \
+        ((struct slhc_index *) ((comp)->tstate + (comp)->tslot_limit + 1))
+
 static BYTE *encode(BYTE *cp, WORD n);
 static long decode(BYTE **cpp);
 static BYTE * put16(BYTE *cp, WORD x);
 static WORD pull16(BYTE **cpp);
 
+static __inline__ int
+slhc_hash(DWORD saddr, DWORD daddr, WORD sport, WORD dport)
+{
+  DWORD h = saddr ^ daddr ^ (((DWORD)sport << 16) | dport);
+
+  h ^= h >> 16;
+  h ^= h >> 8;
+  return h & (SLHC_HASH_SIZE - 1);
+}
+
+static __inline__ int
+slhc_cs_hash(struct cstate *cs)
+{
+  return slhc_hash(cs->cs_ip.saddr, cs->cs_ip.daddr,
+                   cs->cs_tcp.source, cs->cs_tcp.dest);
+}
+
+static void
+slhc_hash_link(struct slhc_index *idx, struct cstate *cs)
+{
+  int h = slhc_cs_hash(cs);
+
+  idx->hnext[cs->cs_this] = idx->head[h];
+  idx->head[h] = cs->cs_this;
+}
+
+static void
+slhc_hash_unlink(struct slhc_index *idx, struct cstate *cs)
+{
+  BYTE *p = &idx->head[slhc_cs_hash(cs)];
+
+  while (*p != SLHC_NONE) {
+    if (*p == cs->cs_this) {
+      *p = idx->hnext[cs->cs_this];
+      return;
+    }
+    p = &idx->hnext[*p];
+  }
+}
+
 /* Initialize compression data structure
  *  slots must be in range 0 to 255 (zero meaning no compression)
  */
@@ -118,7 +176,7 @@ slhc_init(int rslots, int tslots)
   }
 
   if ( tslots > 0  &&  tslots < 256 ) {
-    size_t tsize = tslots * sizeof(struct cstate);
+    size_t tsize = tslots * sizeof(struct cstate) + sizeof(struct slhc_index);
     comp->tstate = (struct cstate *) kmalloc(tsize, GFP_KERNEL);
     if (! comp->tstate)
     {
@@ -142,13 +200,22 @@ slhc_init(int rslots, int tslots)
   comp->flags |= SLF_TOSS;
 
   if ( tslots > 0 ) {
+    struct slhc_index *idx = SLHC_INDEX(comp);
+
     ts = comp->tstate;
     for(i = comp->tslot_limit; i > 0; --i){
       ts[i].cs_this = i;
       ts[i].next = &(ts[i - 1]);
+      idx->prev[i - 1] = i;
     }
     ts[0].next = &(ts[comp->tslot_limit]);
     ts[0].cs_this = 0;
+    idx->prev[comp->tslot_limit] = 0;
+
+    /* All states start out zeroed, in the same bucket */
+    memset(idx->head, SLHC_NONE, sizeof(idx->head));
+    for(i = comp->tslot_limit; i >= 0; --i)
+      slhc_hash_link(idx, &ts[i]);
   }
   MOD_INC_USE_COUNT;
   return comp;
@@ -237,6 +304,8 @@ slhc_compress(struct slcompress *comp, BYTE *icp, int isize,
   register struct cstate *ocs = &(comp->tstate[comp->xmit_oldest]);
   register struct cstate *lcs = ocs;
   register struct cstate *cs = lcs->next;
+  struct slhc_index *idx = SLHC_INDEX(comp);
+  int i;
   register DWORD deltaS, deltaA;
   register short changes = 0;
   int hlen;
@@ -279,26 +348,26 @@ slhc_compress(struct slcompress *comp, BYTE *icp, int isize,
    * States are kept in a circularly linked list with
    * xmit_oldest pointing to the end of the list.  The
    * list is kept in lru order by moving a state to the
-   * head of the list whenever it is referenced.  Since
-   * the list is short and, empirically, the connection
-   * we want is almost always near the front, we locate
-   * states via linear search.  If we don't find a state
-   * for the datagram, the oldest state is (re-)used.
+   * head of the list whenever it is referenced.  With
+   * many slots a linear search gets costly, so states
+   * are located via the hash index; 'prev' gives the
+   * predecessor needed to relink the list.  Searches
+   * now counts hash collisions passed.  If we don't find
+   * a state for the datagram, the oldest state is
+   * (re-)used.
    */
-  for ( ; ; ) {
+  for (i = idx->head[slhc_hash(ip->saddr, ip->daddr, th->source, th->dest)];
+       i != SLHC_NONE; i = idx->hnext[i]) {
+    cs = &comp->tstate[i];
     if( ip->saddr == cs->cs_ip.saddr
      && ip->daddr == cs->cs_ip.daddr
      && th->source == cs->cs_tcp.source
-     && th->dest == cs->cs_tcp.dest)
+     && th->dest == cs->cs_tcp.dest) {
+      lcs = &comp->tstate[idx->prev[i]];
       goto found;
-
-    /* if current equal oldest, at end of list */
-    if ( cs == ocs )
-      break;
-    lcs = cs;
-    cs = cs->next;
+    }
     comp->sls_o_searches++;
-  };
+  }
   /*
    * Didn't find it -- re-use oldest cstate.  Send an
    * uncompressed packet that tells the other side what
@@ -308,6 +377,8 @@ slhc_compress(struct slcompress *comp, BYTE *icp, int isize,
    * state points to the newest and we only need to set
    * xmit_oldest to update the lru linkage.
    */
+  cs = ocs;
+  lcs = &comp->tstate[idx->prev[ocs->cs_this]];
   comp->sls_o_misses++;
   comp->xmit_oldest = lcs->cs_this;
   goto uncompressed;
@@ -324,8 +395,11 @@ found:
   } else {
     /* more than 2 elements */
     lcs->next = cs->next;
+    idx->prev[cs->next->cs_this] = lcs->cs_this;
     cs->next = ocs->next;
+    idx->prev[ocs->next->cs_this] = cs->cs_this;
     ocs->next = cs;
+    idx->prev[cs->cs_this] = ocs->cs_this;
   }
 
   /*
@@ -466,8 +540,10 @@ found:
    * to use on future compressed packets in the protocol field).
    */
 uncompressed:
+  slhc_hash_unlink(idx, cs);
   memcpy(&cs->cs_ip,ip,20);
   memcpy(&cs->cs_tcp,th,20);
+  slhc_hash_link(idx, cs);
   if (ip->ihl > 5)
     memcpy(cs->cs_ipopt, ip+1, ((ip->ihl) - 5) * 4);
   if (th->doff > 5)
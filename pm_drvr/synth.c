@@ -0,0 +1,480 @@
+/*
+ *  synth.c - Synthetic traffic source; a pseudo-NIC that makes
+ *            frames at a set rate or replays a savefile.
+ *
+ *  See synth.h for the options.
+ */
+
+#include "pmdrvr.h"
+#include "module.h"
+#include "synth.h"
+
+#define SYNTH_TYPE  0x88B5    /* local experimental Ethertype */
+
+int synth_debug = 0;
+
+struct synth_private {
+       struct synth_conf       conf;
+       struct net_device_stats stats;
+       int       conf_set;    /* synth_setup() was called        */
+       BYTE     *frame;       /* template, or frame read ahead   */
+       uclock_t  start;       /* uclock() at open                */
+       DWORD     seq;         /* frames made                     */
+       DWORD     rand;
+
+       /* savefile replay */
+       FILE     *fil;
+       int       swapped;     /* file is the other byte order    */
+       int       nsec;        /* time-stamps in nano-sec         */
+       DWORD     frames;      /* frames in one pass              */
+       int       pend_len;    /* frame read ahead, -1 if none    */
+       uclock_t  pend_due;    /* its offset from 'start'         */
+       uclock_t  loop_base;   /* offset of the current pass      */
+       DWORD     first_sec, first_usec;
+     };
+
+static struct synth_private synth_priv;
+
+static int  synth_probe (struct device *dev);
+static int  synth_poll  (struct device *dev, int budget);
+
+struct device synth_dev = {
+              "synth0",
+              "Synthetic traffic source",
+              0,
+              0,0,0,0,0,0,
+              NULL,
+              synth_probe
+            };
+
+/*
+ * IMIX frame lengths (no CRC); 7 x 60, 4 x 572, 1 x 1514.
+ */
+static const WORD imix_len[] = {
+                  60, 572, 60, 60, 572, 60, 1514, 60, 572, 60, 60, 572
+                };
+
+static void synth_defaults (struct synth_conf *c)
+{
+  memset (c, 0, sizeof(*c));
+  c->pps     = 1000;
+  c->burst   = 1;
+  c->min_len = c->max_len = ETH_MIN;
+}
+
+/*
+ * Parse hex bytes "ffffffffffff0200..." into 'buf'. Returns count.
+ */
+static int synth_hex (BYTE *buf, const char *str)
+{
+  int num = 0;
+
+  while (str[0] && str[1] && num < SYNTH_MAX_HDR)
+  {
+    char byte[3];
+
+    byte[0] = str[0];
+    byte[1] = str[1];
+    byte[2] = '\0';
+    buf[num++] = (BYTE) strtoul (byte, NULL, 16);
+    str += 2;
+  }
+  return (num);
+}
+
+static int synth_parse (struct synth_conf *c, const char *spec)
+{
+  char  buf[300], *tok, *val, *end;
+  int   pps_set = 0;
+
+  strncpy (buf, spec, sizeof(buf)-1);
+  buf [sizeof(buf)-1] = '\0';
+
+  for (tok = strtok(buf, ","); tok; tok = strtok(NULL, ","))
+  {
+    val = strchr (tok, '=');
+    if (val)
+       *val++ = '\0';
+
+    if (!strcmp(tok, "loop"))
+       c->loop = 1;
+    else if (!strcmp(tok, "fast"))
+       c->fast = 1;
+    else if (!val)
+       goto bad;
+    else if (!strcmp(tok, "pps"))
+    {
+      c->pps  = strtoul (val, NULL, 0);
+      pps_set = 1;
+    }
+    else if (!strcmp(tok, "burst"))
+       c->burst = atoi (val);
+    else if (!strcmp(tok, "count"))
+       c->count = strtoul (val, NULL, 0);
+    else if (!strcmp(tok, "seed"))
+       c->seed = strtoul (val, NULL, 0);
+    else if (!strcmp(tok, "hdr"))
+       c->hdr_len = synth_hex (c->hdr, val);
+    else if (!strcmp(tok, "file"))
+    {
+      strncpy (c->file, val, sizeof(c->file)-1);
+      c->file [sizeof(c->file)-1] = '\0';
+    }
+    else if (!strcmp(tok, "size"))
+    {
+      if (!strcmp(val, "imix"))
+         c->imix = 1;
+      else
+      {
+        c->imix    = 0;
+        c->min_len = c->max_len = strtol (val, &end, 0);
+        if (*end == '-')
+           c->max_len = strtol (end+1, NULL, 0);
+      }
+    }
+    else
+      goto bad;
+  }
+
+  if (c->file[0] && !pps_set)   /* replay at the time-stamps */
+     c->pps = 0;
+  if (c->burst < 1)
+     c->burst = 1;
+  if (c->min_len < ETH_MIN)
+     c->min_len = ETH_MIN;
+  if (c->max_len > ETH_MAX)
+     c->max_len = ETH_MAX;
+  if (c->max_len < c->min_len)
+     c->max_len = c->min_len;
+  return (1);
+
+bad:
+  printk ("synth: bad option `%s'\n", tok);
+  return (0);
+}
+
+/*
+ * Set up the frames to make; see synth.h. Overrides "PCAP_SYNTH".
+ * Takes effect at the next open. Returns 0 on a bad option.
+ */
+int synth_setup (const char *spec)
+{
+  struct synth_conf conf;
+
+  synth_defaults (&conf);
+  if (!synth_parse (&conf, spec))
+     return (0);
+  synth_priv.conf     = conf;
+  synth_priv.conf_set = 1;
+  return (1);
+}
+
+/*
+ * Add "synth0" to the device list.
+ */
+int synth_register (void)
+{
+  static int done = 0;
+
+  if (!done && register_netdev (&synth_dev) == 0)
+     done = 1;
+  return (done);
+}
+
+static DWORD get_dword (const BYTE *p, int swapped)
+{
+  if (swapped)
+     return (((DWORD)p[0] << 24) + ((DWORD)p[1] << 16) + (p[2] << 8) + p[3]);
+  return (p[0] + (p[1] << 8) + ((DWORD)p[2] << 16) + ((DWORD)p[3] << 24));
+}
+
+static int synth_file_open (struct synth_private *sp)
+{
+  BYTE  hdr[24];
+  DWORD magic;
+
+  sp->fil = fopen (sp->conf.file, "rb");
+  if (!sp->fil)
+  {
+    printk ("synth: cannot open `%s'\n", sp->conf.file);
+    return (0);
+  }
+  if (fread (hdr, 1, sizeof(hdr), sp->fil) != sizeof(hdr))
+     goto bad;
+
+  magic = get_dword (hdr, 0);
+  sp->swapped = (magic == 0xD4C3B2A1 || magic == 0x4D3CB2A1);
+  sp->nsec    = (magic == 0xA1B23C4D || magic == 0x4D3CB2A1);
+  if (!sp->swapped && !sp->nsec && magic != 0xA1B2C3D4)
+     goto bad;
+
+  if (get_dword (hdr+20, sp->swapped) != 1)   /* DLT_EN10MB */
+  {
+    printk ("synth: `%s' is not an Ethernet savefile\n", sp->conf.file);
+    fclose (sp->fil);
+    sp->fil = NULL;
+    return (0);
+  }
+  sp->frames    = 0;
+  sp->pend_len  = -1;
+  sp->loop_base = 0;
+  return (1);
+
+bad:
+  printk ("synth: `%s' is not a savefile\n", sp->conf.file);
+  fclose (sp->fil);
+  sp->fil = NULL;
+  return (0);
+}
+
+/*
+ * Read the next savefile frame into 'sp->frame'. Returns 0 at the end
+ * of the file, unless told to start over.
+ */
+static int synth_file_next (struct synth_private *sp)
+{
+  BYTE  rec[16];
+  DWORD sec, usec, caplen, keep;
+  long long ofs;
+
+  while (fread (rec, 1, sizeof(rec), sp->fil) != sizeof(rec))
+  {
+    if (!sp->conf.loop || !sp->frames)
+       return (0);
+
+    /* The next pass starts where this one ended
+     */
+    fseek (sp->fil, 24, SEEK_SET);
+    sp->loop_base = sp->pend_due;
+    sp->frames    = 0;
+  }
+
+  sec    = get_dword (rec, sp->swapped);
+  usec   = get_dword (rec+4, sp->swapped);
+  caplen = get_dword (rec+8, sp->swapped);
+  if (sp->nsec)
+     usec /= 1000;
+
+  keep = caplen > ETH_MAX ? ETH_MAX : caplen;
+  if (fread (sp->frame, 1, keep, sp->fil) != keep)
+     return (0);
+  if (caplen > keep)
+     fseek (sp->fil, caplen - keep, SEEK_CUR);
+
+  if (sp->frames++ == 0)
+  {
+    sp->first_sec  = sec;
+    sp->first_usec = usec;
+  }
+  ofs = (long long)(long)(sec - sp->first_sec) * 1000000 +
+        (long)(usec - sp->first_usec);
+  if (ofs < 0)
+     ofs = 0;
+  sp->pend_due = sp->loop_base + (uclock_t)ofs * UCLOCKS_PER_SEC / 1000000;
+  sp->pend_len = keep;
+  return (1);
+}
+
+/*
+ * Length of the next generated frame.
+ */
+static int synth_len (struct synth_private *sp)
+{
+  const struct synth_conf *c = &sp->conf;
+
+  if (c->imix)
+     return imix_len [sp->seq % DIM(imix_len)];
+
+  if (c->min_len == c->max_len)
+     return (c->min_len);
+
+  sp->rand = sp->rand * 1103515245UL + 12345;
+  return (c->min_len + ((sp->rand >> 16) & 0x7FFF) % (c->max_len - c->min_len + 1));
+}
+
+/*
+ * Header template, frame number and a byte pattern.
+ */
+static void synth_template (struct device *dev, struct synth_private *sp)
+{
+  struct synth_conf *c = &sp->conf;
+  int    i;
+
+  if (!c->hdr_len)
+  {
+    memcpy (c->hdr, dev->dev_addr, ETH_ALEN);
+    memcpy (c->hdr + ETH_ALEN, dev->dev_addr, ETH_ALEN);
+    c->hdr [2*ETH_ALEN-1] ^= 0x80;           /* not from ourself */
+    c->hdr [2*ETH_ALEN]   = SYNTH_TYPE >> 8;
+    c->hdr [2*ETH_ALEN+1] = SYNTH_TYPE & 255;
+    c->hdr_len = 2*ETH_ALEN + 2;
+  }
+  memcpy (sp->frame, c->hdr, c->hdr_len);
+  for (i = c->hdr_len; i < ETH_MAX; i++)
+      sp->frame[i] = (BYTE) i;
+}
+
+static int synth_open (struct device *dev)
+{
+  struct synth_private *sp = (struct synth_private*) dev->priv;
+  const  char *env = getenv (SYNTH_PARAM);
+
+  if (!dev->poll_ok)
+  {
+    printk ("%s: needs netif_poll() from the capture loop\n", dev->name);
+    return (0);
+  }
+
+  if (!sp->conf_set)
+  {
+    synth_defaults (&sp->conf);
+    if (env && !synth_parse (&sp->conf, env))
+       return (0);
+  }
+
+  sp->frame = k_malloc (ETH_MAX);
+  if (!sp->frame)
+     return (0);
+
+  if (sp->conf.file[0])
+  {
+    if (!synth_file_open (sp))
+    {
+      k_free (sp->frame);
+      return (0);
+    }
+  }
+  else
+    synth_template (dev, sp);
+
+  if (synth_debug > 0)
+     printk ("%s: %s, %lu pps, burst %d, size %d-%d%s\n", dev->name,
+             sp->conf.file[0] ? sp->conf.file : "generated", sp->conf.pps,
+             sp->conf.burst, sp->conf.min_len, sp->conf.max_len,
+             sp->conf.imix ? " (imix)" : "");
+
+  memset (&sp->stats, 0, sizeof(sp->stats));
+  sp->seq   = 0;
+  sp->rand  = sp->conf.seed;
+  sp->start = uclock();
+
+  dev->poll = synth_poll;
+  netif_rx_schedule (dev);   /* stays polled while open */
+  dev->tx_busy = 0;
+  dev->start   = 1;
+  return (1);
+}
+
+static void synth_close (struct device *dev)
+{
+  struct synth_private *sp = (struct synth_private*) dev->priv;
+
+  dev->start = 0;
+  netif_rx_complete (dev);
+  if (sp->fil)
+     fclose (sp->fil);
+  sp->fil = NULL;
+  if (sp->frame)
+     k_free (sp->frame);
+  sp->frame = NULL;
+}
+
+/*
+ * Frames sent to us are counted and dropped.
+ */
+static int synth_xmit (struct device *dev, const void *buf, int len)
+{
+  struct synth_private *sp = (struct synth_private*) dev->priv;
+
+  sp->stats.tx_packets++;
+  sp->stats.tx_bytes += len;
+  ARGSUSED (buf);
+  return (1);
+}
+
+static void *synth_get_stats (struct device *dev)
+{
+  struct synth_private *sp = (struct synth_private*) dev->priv;
+
+  return (&sp->stats);
+}
+
+/*
+ * When the next frame is due, as an offset from 'start'.
+ */
+static uclock_t synth_due (const struct synth_private *sp)
+{
+  const struct synth_conf *c = &sp->conf;
+
+  if (sp->fil && !c->pps && !c->fast)
+     return (sp->pend_due);
+
+  if (!c->pps || c->fast)
+     return (0);
+
+  return ((uclock_t)(sp->seq / c->burst) * c->burst * UCLOCKS_PER_SEC / c->pps);
+}
+
+/*
+ * Hand the frames due by now to get_rx_buf(), at most 'budget'.
+ */
+static int synth_poll (struct device *dev, int budget)
+{
+  struct synth_private *sp = (struct synth_private*) dev->priv;
+  struct synth_conf    *c  = &sp->conf;
+  uclock_t now = uclock() - sp->start;
+  BYTE    *buf;
+  int      n, len;
+
+  for (n = 0; n < budget; n++)
+  {
+    if (c->count && sp->seq >= c->count)
+       break;
+    if (sp->fil && sp->pend_len < 0 && !synth_file_next (sp))
+       break;
+    if (synth_due (sp) > now)
+       break;
+
+    if (sp->fil)
+    {
+      len = sp->pend_len;
+      sp->pend_len = -1;
+    }
+    else
+    {
+      len = synth_len (sp);
+      if (c->hdr_len + 4 <= len)
+      {
+        sp->frame [c->hdr_len]   = (BYTE) (sp->seq >> 24);
+        sp->frame [c->hdr_len+1] = (BYTE) (sp->seq >> 16);
+        sp->frame [c->hdr_len+2] = (BYTE) (sp->seq >> 8);
+        sp->frame [c->hdr_len+3] = (BYTE) sp->seq;
+      }
+    }
+    sp->seq++;
+
+    buf = dev->get_rx_buf ? (*dev->get_rx_buf) (len) : NULL;
+    if (!buf)
+    {
+      sp->stats.rx_dropped++;
+      continue;
+    }
+    memcpy (buf, sp->frame, len);
+    sp->stats.rx_packets++;
+    sp->stats.rx_bytes += len;
+  }
+  return (n);
+}
+
+static int synth_probe (struct device *dev)
+{
+  ether_setup (dev);
+  dev->dev_addr[0] = 0x02;     /* locally administered */
+  dev->dev_addr[5] = 0x01;
+  dev->priv      = &synth_priv;
+  dev->open      = synth_open;
+  dev->close     = synth_close;
+  dev->xmit      = synth_xmit;
+  dev->get_stats = synth_get_stats;
+  return (1);
+}
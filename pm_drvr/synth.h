@@ -0,0 +1,58 @@
+#ifndef __SYNTH_H
+#define __SYNTH_H
+
+/*
+ * Synthetic traffic source. A pseudo-NIC ("synth0") that feeds frames
+ * into dev->get_rx_buf() at a set rate, so the capture path (ring,
+ * filter, consumer) can be benchmarked the same way on every run and
+ * without a NIC. Nothing here touches hardware.
+ *
+ * The frames are made in the device's poll() hook; the device stays
+ * in polled mode while open. Frames due since the last netif_poll()
+ * are produced then, up to the budget. So the capture layer must set
+ * dev->poll_ok before open; without it synth0 won't open.
+ *
+ * Like the other drivers here it is built with djgpp only.
+ *
+ * Set up with synth_setup() or "set PCAP_SYNTH=..."; a comma separated
+ * list of:
+ *   pps=N          frames per second (0 = as fast as polled)
+ *   burst=N        frames sent back-to-back at each departure
+ *   size=N         frame length (no CRC), or
+ *   size=N-M       uniformly random in [N,M], or
+ *   size=imix      60, 572 and 1514 bytes in a 7:4:1 mix
+ *   count=N        stop after N frames
+ *   seed=N         for the random sizes
+ *   hdr=HEX        frame header template (default: to us, type 88B5)
+ *   file=NAME      replay a savefile instead (Ethernet only)
+ *   loop           start the savefile over at its end
+ *   fast           ignore the savefile time-stamps
+ *
+ * A generated frame is the header template, a 32-bit frame number
+ * (network order) and a byte pattern. A replayed frame is sent at
+ * its time-stamp offset unless 'pps' or 'fast' is given.
+ */
+#define SYNTH_PARAM    "PCAP_SYNTH"
+#define SYNTH_MAX_HDR  64
+
+struct synth_conf {
+       DWORD  pps;
+       int    burst;
+       int    min_len, max_len;
+       int    imix;
+       DWORD  count;
+       DWORD  seed;
+       BYTE   hdr [SYNTH_MAX_HDR];
+       int    hdr_len;
+       char   file [80];
+       int    loop;
+       int    fast;
+     };
+
+extern struct device synth_dev;
+extern int synth_debug;
+
+extern int synth_setup    (const char *spec);
+extern int synth_register (void);
+
+#endif
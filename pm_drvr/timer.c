@@ -184,6 +184,14 @@ int del_timer (struct timer_list *timer)
 }
 
 
+/*
+ * Timer interrupts per second; timeouts expire on these ticks.
+ */
+int timer_rate (void)
+{
+  return (timer_ips);
+}
+
 /*
  * set timer debug level
  */
@@ -34,6 +34,7 @@ extern int  add_timer  (struct timer_list *timer) LOCKED_FUNC;
 extern int  del_timer  (struct timer_list *timer) LOCKED_FUNC;
 extern void stop_timer (void)                     LOCKED_FUNC;
 extern int  debug_timer(int lvl);
+extern int  timer_rate (void);
 
 #endif
 #endif
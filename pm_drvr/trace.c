@@ -0,0 +1,223 @@
+/*
+ *  trace.c - Binary trace ring. Events are stored raw at interrupt
+ *            time and formatted later; see trace.h.
+ */
+
+#include "pmdrvr.h"
+#include "module.h"
+#include "trace.h"
+
+#define TRACE_MAX_FMTS  256   /* distinct formats trace_save() keeps */
+
+volatile DWORD trace_mask LOCKED_VAR = 0;
+
+static struct trace_rec *trace_ring LOCKED_VAR = NULL;
+static DWORD             trace_size LOCKED_VAR = 0;  /* records, 2^n   */
+static volatile DWORD    trace_head LOCKED_VAR = 1;  /* next event no. */
+static DWORD             trace_tail = 1;             /* next to drain  */
+static DWORD             trace_lost = 0;             /* overwritten    */
+
+/*
+ * Allocate a ring of at least 'num' events and enable the subsystems
+ * in 'mask' (or in "PCAP_TRACE" if set). Returns 0 on failure.
+ */
+int trace_init (int num, DWORD mask)
+{
+  const char *env = getenv (TRACE_PARAM);
+  DWORD size = 1;
+
+  if (trace_ring)
+     return (1);
+
+  while (size < (DWORD)num)
+        size <<= 1;
+
+  trace_ring = k_calloc (size, sizeof(*trace_ring));
+  if (!trace_ring)
+  {
+    printk ("trace: no memory for %lu events\n", size);
+    return (0);
+  }
+  uclock();  /* the first call sets up the PIT; do it here and not in an ISR */
+
+  trace_size = size;
+  trace_head = trace_tail = 1;
+  trace_lost = 0;
+  trace_mask = env ? strtoul (env, NULL, 0) : mask;
+  return (1);
+}
+
+void trace_exit (void)
+{
+  trace_mask = 0;
+  if (trace_lost)
+     printk ("trace: %lu events lost\n", trace_lost);
+  if (trace_ring)
+     k_free (trace_ring);
+  trace_ring = NULL;
+}
+
+/*
+ * Store an event. The event number is claimed with one atomic add,
+ * so an interrupt handler tracing in the middle of this gets the
+ * next record. The oldest records are overwritten when the ring
+ * is full.
+ */
+void trace_log (int sub, const char *fmt, int nargs,
+                DWORD a0, DWORD a1, DWORD a2, DWORD a3)
+{
+  struct trace_rec *rec;
+  DWORD  seq = 1;
+
+  if (!trace_ring)
+     return;
+
+  __asm__ __volatile__ ("lock; xaddl %0, %1"
+                        : "+r" (seq), "+m" (trace_head) : : "memory");
+
+  rec = trace_ring + (seq & (trace_size-1));
+  rec->seq    = 0;          /* being written */
+  rec->stamp  = uclock();
+  rec->fmt    = fmt;
+  rec->sub    = sub;
+  rec->nargs  = nargs;
+  rec->arg[0] = a0;
+  rec->arg[1] = a1;
+  rec->arg[2] = a2;
+  rec->arg[3] = a3;
+  rec->seq    = seq;
+}
+
+/*
+ * Copy event 'seq' to 'rec'. Returns 0 if it was overwritten (or is
+ * being written).
+ */
+static int trace_get (DWORD seq, struct trace_rec *rec)
+{
+  const struct trace_rec *slot = trace_ring + (seq & (trace_size-1));
+
+  if (slot->seq != seq)
+     return (0);
+  *rec = *slot;
+  return (slot->seq == seq);  /* not overwritten while copying */
+}
+
+/*
+ * First event still in the ring.
+ */
+static DWORD trace_first (DWORD head)
+{
+  if (head - trace_tail > trace_size)
+  {
+    trace_lost += head - trace_tail - trace_size;
+    trace_tail  = head - trace_size;
+  }
+  return (trace_tail);
+}
+
+/*
+ * Format and printk() the events stored since the last call. Must
+ * not be called from an interrupt handler. Returns number of events.
+ */
+int trace_drain (void)
+{
+  struct trace_rec rec;
+  DWORD  head = trace_head;
+  DWORD  sec, usec;
+  char   buf[200];
+  int    num = 0;
+
+  if (!trace_ring)
+     return (0);
+
+  for (trace_first(head); trace_tail != head; trace_tail++)
+  {
+    if (!trace_get(trace_tail, &rec))
+    {
+      trace_lost++;
+      continue;
+    }
+    sec  = (DWORD) (rec.stamp / UCLOCKS_PER_SEC);
+    usec = (DWORD) ((rec.stamp % UCLOCKS_PER_SEC) * 1000000 / UCLOCKS_PER_SEC);
+    _snprintk (buf, sizeof(buf), rec.fmt,
+               rec.arg[0], rec.arg[1], rec.arg[2], rec.arg[3]);
+    printk ("%lu.%06lu %s", sec, usec, buf);
+    num++;
+  }
+  return (num);
+}
+
+static int put_dwords (FILE *fil, const DWORD *val, int num)
+{
+  return (fwrite (val, sizeof(DWORD), num, fil) == num);
+}
+
+/*
+ * Write the events not yet drained to 'file' for 'trcdump'. The
+ * events stay in the ring. Returns number of events written, or -1
+ * if the file couldn't be written.
+ */
+int trace_save (const char *file)
+{
+  static const char *fmts [TRACE_MAX_FMTS];
+  struct trace_rec rec;
+  FILE  *fil;
+  DWORD  head = trace_head;
+  DWORD  seq, hdr[5], val[TRACE_REC_WORDS];
+  DWORD  num_fmts = 0, num_recs = 0;
+  int    i, ok;
+
+  if (!trace_ring)
+     return (-1);
+
+  fil = fopen (file, "wb");
+  if (!fil)
+  {
+    printk ("trace: cannot open `%s'\n", file);
+    return (-1);
+  }
+
+  hdr[0] = TRACE_MAGIC;
+  hdr[1] = hdr[2] = hdr[3] = 0;   /* filled in below */
+  hdr[4] = UCLOCKS_PER_SEC;
+  ok = put_dwords (fil, hdr, 5);
+
+  for (seq = trace_first(head); ok && seq != head; seq++)
+  {
+    if (!trace_get(seq, &rec))
+       continue;
+
+    for (i = 0; i < num_fmts; i++)
+        if (fmts[i] == rec.fmt)
+           break;
+    if (i == num_fmts && num_fmts < TRACE_MAX_FMTS)
+       fmts [num_fmts++] = rec.fmt;
+
+    val[0] = (DWORD) rec.stamp;
+    val[1] = (DWORD) (rec.stamp >> 32);
+    val[2] = (DWORD) rec.fmt;
+    val[3] = rec.seq;
+    val[4] = rec.sub;
+    val[5] = rec.nargs;
+    for (i = 0; i < TRACE_MAX_ARGS; i++)
+        val[6+i] = rec.arg[i];
+    ok = put_dwords (fil, val, TRACE_REC_WORDS);
+    num_recs++;
+  }
+
+  for (i = 0; ok && i < num_fmts; i++)
+  {
+    val[0] = (DWORD) fmts[i];
+    val[1] = strlen (fmts[i]);
+    ok = put_dwords (fil, val, 2) &&
+         fwrite (fmts[i], 1, val[1], fil) == val[1];
+  }
+
+  hdr[1] = num_recs;
+  hdr[2] = num_fmts;
+  hdr[3] = trace_lost;
+  if (ok)
+     ok = (fseek (fil, 0, SEEK_SET) == 0 && put_dwords (fil, hdr, 5));
+  fclose (fil);
+  return (ok ? (int)num_recs : -1);
+}
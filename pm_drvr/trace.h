@@ -0,0 +1,78 @@
+#ifndef __TRACE_H
+#define __TRACE_H
+
+/*
+ * Binary trace ring. An event stores a time-stamp, its format string
+ * (by address) and up to 4 integer arguments; nothing is formatted
+ * at interrupt time. trace_drain() formats the stored events through
+ * printk() in the foreground, and trace_save() writes them to a file
+ * for 'trcdump' to format later.
+ *
+ * A %s argument must point to a string that stays put (e.g.
+ * dev->name); trcdump can only print its address.
+ *
+ * Each event belongs to a subsystem in 'trace_mask'. A disabled event
+ * costs one test; an enabled one a handful of stores.
+ */
+#define TRC_IRQ     0x0001
+#define TRC_RX      0x0002
+#define TRC_TX      0x0004
+#define TRC_DMA     0x0008
+#define TRC_TIMER   0x0010
+#define TRC_PCI     0x0020
+#define TRC_DRVR    0x0040   /* driver specific */
+#define TRC_ALL     0xFFFF
+
+#define TRACE_PARAM     "PCAP_TRACE"   /* "set PCAP_TRACE=0x43" sets mask */
+#define TRACE_MAX_ARGS  4
+
+struct trace_rec {
+       uclock_t    stamp;
+       const char *fmt;
+       DWORD       seq;              /* event number, written last */
+       WORD        sub;
+       WORD        nargs;
+       DWORD       arg [TRACE_MAX_ARGS];
+     };
+
+extern volatile DWORD trace_mask LOCKED_VAR;
+
+extern int  trace_init  (int num, DWORD mask);
+extern void trace_exit  (void);
+extern int  trace_drain (void);
+extern int  trace_save  (const char *file);
+extern void trace_log   (int sub, const char *fmt, int nargs,
+                         DWORD a0, DWORD a1, DWORD a2, DWORD a3) LOCKED_FUNC;
+
+#define TRACE0(sub,fmt) \
+        do { if (trace_mask & (sub)) \
+               trace_log (sub, fmt, 0, 0, 0, 0, 0); } while (0)
+
+#define TRACE1(sub,fmt,a) \
+        do { if (trace_mask & (sub)) \
+               trace_log (sub, fmt, 1, (DWORD)(a), 0, 0, 0); } while (0)
+
+#define TRACE2(sub,fmt,a,b) \
+        do { if (trace_mask & (sub)) \
+               trace_log (sub, fmt, 2, (DWORD)(a), (DWORD)(b), 0, 0); } while (0)
+
+#define TRACE3(sub,fmt,a,b,c) \
+        do { if (trace_mask & (sub)) \
+               trace_log (sub, fmt, 3, (DWORD)(a), (DWORD)(b), \
+                          (DWORD)(c), 0); } while (0)
+
+#define TRACE4(sub,fmt,a,b,c,d) \
+        do { if (trace_mask & (sub)) \
+               trace_log (sub, fmt, 4, (DWORD)(a), (DWORD)(b), \
+                          (DWORD)(c), (DWORD)(d)); } while (0)
+
+/*
+ * trace_save() file layout; all fields are little-endian DWORDs.
+ *   header: TRACE_MAGIC, num_recs, num_fmts, lost, UCLOCKS_PER_SEC
+ *   num_recs times: stamp (low, high), fmt, seq, sub, nargs, arg[4]
+ *   num_fmts times: address, length, 'length' bytes of format
+ */
+#define TRACE_MAGIC     0x43525450     /* "PTRC" */
+#define TRACE_REC_WORDS 10
+
+#endif
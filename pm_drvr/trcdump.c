@@ -0,0 +1,188 @@
+/*
+ *  trcdump.c - Format a trace file written by trace_save().
+ *
+ *  Usage: trcdump file
+ *
+ *  Needs nothing from the drivers; may be built for any little-endian
+ *  host. %s arguments are printed as their address.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef unsigned long DWORD;
+
+#define TRACE_MAGIC     0x43525450     /* "PTRC", see trace.h */
+#define TRACE_REC_WORDS 10
+
+struct fmt {
+       DWORD  addr;
+       char  *str;
+     };
+
+static struct fmt *fmts;
+static DWORD       num_fmts;
+
+static int get_dwords (FILE *fil, DWORD *val, int num)
+{
+  unsigned char b[4];
+  int    i;
+
+  for (i = 0; i < num; i++)
+  {
+    if (fread (b, 1, 4, fil) != 4)
+       return (0);
+    val[i] = b[0] + (b[1] << 8) + ((DWORD)b[2] << 16) + ((DWORD)b[3] << 24);
+  }
+  return (1);
+}
+
+static const char *find_fmt (DWORD addr)
+{
+  DWORD i;
+
+  for (i = 0; i < num_fmts; i++)
+      if (fmts[i].addr == addr)
+         return (fmts[i].str);
+  return (NULL);
+}
+
+/*
+ * Print 'fmt' with integer arguments 'arg'. Handles the conversions
+ * of _vsnprintk() that make sense for a stored argument.
+ */
+static void print_fmt (const char *fmt, const DWORD *arg, int nargs)
+{
+  char   spec[32];
+  int    n = 0;
+
+  while (*fmt)
+  {
+    const char *start = fmt;
+    DWORD  val;
+    int    len;
+
+    if (*fmt != '%')
+    {
+      putchar (*fmt++);
+      continue;
+    }
+    fmt++;
+    if (*fmt == '%')
+    {
+      putchar (*fmt++);
+      continue;
+    }
+    while (*fmt && strchr ("0123456789.-l", *fmt))
+          fmt++;
+    if (!*fmt)
+       break;
+
+    val = n < nargs ? arg[n] : 0;
+    n++;
+
+    len = fmt - start;
+    if (len > (int)sizeof(spec) - 3)
+        len = sizeof(spec) - 3;
+    memcpy (spec, start, len);
+    spec[len] = '\0';
+    if (!strchr(spec, 'l'))
+       strcat (spec, "l");
+    len = strlen (spec);
+    spec[len]   = *fmt;
+    spec[len+1] = '\0';
+
+    switch (*fmt)
+    {
+      case 'd':                    /* sign-extend the 32-bit value */
+           printf (spec, (long)(int)val);
+           break;
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X':
+           printf (spec, val);
+           break;
+      case 'c':
+           putchar ((int)val);
+           break;
+      case 'p':
+           printf ("0x%08lX", val);
+           break;
+      case 'I':
+           printf ("%lu.%lu.%lu.%lu", val & 255, (val >> 8) & 255,
+                   (val >> 16) & 255, val >> 24);
+           break;
+      case 's':
+      case 'v':
+      case 'q':
+      default:
+           printf ("<%08lX>", val);
+           break;
+    }
+    fmt++;
+  }
+}
+
+int main (int argc, char **argv)
+{
+  DWORD  hdr[5], rec[TRACE_REC_WORDS], i, len;
+  long   recs_at;
+  double stamp, first = -1.0;
+  FILE  *fil;
+
+  if (argc != 2)
+  {
+    fprintf (stderr, "Usage: %s file\n", argv[0]);
+    return (1);
+  }
+  fil = fopen (argv[1], "rb");
+  if (!fil)
+  {
+    perror (argv[1]);
+    return (1);
+  }
+  if (!get_dwords(fil, hdr, 5) || hdr[0] != TRACE_MAGIC || !hdr[4])
+  {
+    fprintf (stderr, "%s: not a trace file\n", argv[1]);
+    return (1);
+  }
+
+  /* The format strings follow the records
+   */
+  recs_at = ftell (fil);
+  fseek (fil, recs_at + 4L * TRACE_REC_WORDS * hdr[1], SEEK_SET);
+  num_fmts = hdr[2];
+  fmts = calloc (num_fmts + 1, sizeof(*fmts));
+  for (i = 0; i < num_fmts; i++)
+  {
+    if (!get_dwords(fil, rec, 2))
+       break;
+    len = rec[1];
+    fmts[i].addr = rec[0];
+    fmts[i].str  = calloc (len + 1, 1);
+    if (!fmts[i].str || fread (fmts[i].str, 1, len, fil) != len)
+       break;
+  }
+  num_fmts = i;
+
+  fseek (fil, recs_at, SEEK_SET);
+  for (i = 0; i < hdr[1] && get_dwords(fil, rec, TRACE_REC_WORDS); i++)
+  {
+    const char *fmt = find_fmt (rec[2]);
+
+    stamp = (rec[0] + 4294967296.0 * rec[1]) / hdr[4];
+    if (first < 0.0)
+       first = stamp;
+    printf ("%10lu %12.6f %04lX ", rec[3], stamp - first, rec[4]);
+    if (fmt)
+         print_fmt (fmt, rec + 6, (int)rec[5]);
+    else printf ("fmt %08lX: %08lX %08lX %08lX %08lX\n",
+                 rec[2], rec[6], rec[7], rec[8], rec[9]);
+  }
+  if (hdr[3])
+     printf ("%lu events lost\n", hdr[3]);
+  fclose (fil);
+  return (0);
+}
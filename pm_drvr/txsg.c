@@ -0,0 +1,66 @@
+/*
+ *  txsg.c - Scatter-gather transmit and the copy fallback.
+ *
+ *  See txsg.h for who owns the fragments and when.
+ */
+
+#include "pmdrvr.h"
+#include "module.h"
+#include "txsg.h"
+
+/*
+ * Total length of a fragment list.
+ */
+int tx_frag_len (const struct tx_frag *frag, int nfrag)
+{
+  int i, len = 0;
+
+  for (i = 0; i < nfrag; i++)
+      len += frag[i].len;
+  return (len);
+}
+
+/*
+ * Gather a fragment list into 'buf'. Returns the length.
+ */
+int tx_frag_copy (BYTE *buf, const struct tx_frag *frag, int nfrag)
+{
+  int i, len = 0;
+
+  for (i = 0; i < nfrag; i++)
+  {
+    memcpy (buf + len, frag[i].data, frag[i].len);
+    len += frag[i].len;
+  }
+  return (len);
+}
+
+/*
+ * Transmit the frame in 'frag[0..nfrag-1]'. Returns 0 if it wasn't
+ * queued (transmitter busy or frame too long); 'done' is not called
+ * then and the caller still owns the fragments.
+ */
+int netif_xmit_sg (struct device *dev, const struct tx_frag *frag,
+                   int nfrag, tx_done_fn done, void *arg)
+{
+  BYTE buf [ETH_MAX];
+  int  len;
+
+  if (nfrag <= 0 || !dev->start)
+     return (0);
+
+  if (dev->xmit_sg && nfrag <= dev->tx_max_frags)
+     return (*dev->xmit_sg) (dev, frag, nfrag, done, arg);
+
+  len = tx_frag_len (frag, nfrag);
+  if (len > (int)sizeof(buf))
+     return (0);
+
+  tx_frag_copy (buf, frag, nfrag);
+  if (!(*dev->xmit) (dev, buf, len))
+     return (0);
+
+  if (done)
+    (*done) (arg, 1);
+  return (1);
+}
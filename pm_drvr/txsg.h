@@ -0,0 +1,39 @@
+#ifndef __TXSG_H
+#define __TXSG_H
+
+/*
+ * Scatter-gather transmit without a copy.
+ *
+ * A frame is given as a list of fragments (e.g. a header template
+ * followed by the payload). A driver that sets dev->xmit_sg points its
+ * Tx descriptors at the fragments themselves and the NIC reads them
+ * by bus-master DMA; the fragments belong to the NIC until 'done' is
+ * called. Fragments must be in locked memory (k_malloc() or
+ * dma_pool_alloc()), as the NIC reads them at VIRT_TO_BUS().
+ *
+ * 'done (arg, ok)' is called once per frame the driver accepted, with
+ * 'ok' = 0 if it was aborted or discarded by a reset or close. It is
+ * called from the interrupt handler, so it must be a LOCKED_FUNC that
+ * only marks the fragments free; it must not transmit.
+ *
+ * netif_xmit_sg() falls back to copying the fragments into one buffer
+ * for dev->xmit() when the driver has no xmit_sg(), or the frame has
+ * more fragments than dev->tx_max_frags. 'done' is then called before
+ * netif_xmit_sg() returns.
+ */
+#define TX_MAX_FRAGS  16
+
+struct tx_frag {
+       const void *data;
+       int         len;
+     };
+
+typedef void (*tx_done_fn) (void *arg, int ok);
+
+extern int netif_xmit_sg (struct device *dev, const struct tx_frag *frag,
+                          int nfrag, tx_done_fn done, void *arg);
+
+extern int tx_frag_len   (const struct tx_frag *frag, int nfrag);
+extern int tx_frag_copy  (BYTE *buf, const struct tx_frag *frag, int nfrag);
+
+#endif